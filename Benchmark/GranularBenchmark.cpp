@@ -0,0 +1,267 @@
+/*
+  ==============================================================================
+    GranularBenchmark.cpp
+    Headless throughput benchmark for GranularEngine. Renders a matrix of
+    engine settings on noise input and reports, per case, the render cost per
+    sample, the active grain count and the real-time factor. Results go to
+    the console and, with --json, to a machine-readable file for tracking
+    throughput between releases.
+
+    GranularBenchmark [--quick] [--seconds N] [--isa scalar|sse41|avx2|avx512]
+                      [--threads] [--json results.json]
+  ==============================================================================
+*/
+
+#include "DSP/GranularEngine.h"
+#include <juce_core/juce_core.h>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    struct BenchmarkCase
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 256;
+        float density = 30.0f;        // grains per second
+        float grainSizeMs = 100.0f;
+        float pitchScatter = 0.0f;    // %
+        float feedback = 0.0f;
+        float shimmer = 0.0f;         // %
+    };
+
+    struct BenchmarkResult
+    {
+        double nsPerSample = 0.0;     // wall time per sample frame
+        double realtimeFactor = 0.0;  // audio seconds rendered per wall second
+        double meanActiveGrains = 0.0;
+        int peakActiveGrains = 0;
+        juce::uint64 steals = 0;      // during the timed blocks
+        juce::uint64 exhausted = 0;
+    };
+
+    struct Options
+    {
+        bool quick = false;
+        double seconds = 2.0;         // timed audio per case
+        bool multithreaded = false;
+        bool forceInstructionSet = false;
+        SimdKernels::InstructionSet instructionSet = SimdKernels::InstructionSet::Scalar;
+        juce::File jsonFile;
+    };
+
+    constexpr double kWarmUpSeconds = 1.0;   // untimed, fills the circular buffer and the pool
+    constexpr int kNumChannels = 2;
+
+    std::vector<BenchmarkCase> makeMatrix (bool quick)
+    {
+        const std::vector<double> sampleRates = quick ? std::vector<double> { 48000.0 }
+                                                      : std::vector<double> { 44100.0, 48000.0, 96000.0 };
+        const std::vector<int> blockSizes     = quick ? std::vector<int> { 256 } : std::vector<int> { 64, 256, 1024 };
+        const std::vector<float> densities    = { 10.0f, 100.0f, 500.0f };
+        const std::vector<float> grainSizes   = { 20.0f, 100.0f, 500.0f };
+        const std::vector<float> pitchScatter = { 0.0f, 50.0f };
+        const std::vector<float> feedback     = { 0.0f, 0.5f };
+        const std::vector<float> shimmer      = { 0.0f, 50.0f };
+
+        std::vector<BenchmarkCase> cases;
+
+        for (auto sr : sampleRates)
+            for (auto bs : blockSizes)
+                for (auto d : densities)
+                    for (auto g : grainSizes)
+                        for (auto ps : pitchScatter)
+                            for (auto fb : feedback)
+                                for (auto sh : shimmer)
+                                    cases.push_back ({ sr, bs, d, g, ps, fb, sh });
+
+        return cases;
+    }
+
+    BenchmarkResult runCase (const BenchmarkCase& c, const Options& options)
+    {
+        auto engine = std::make_unique<GranularEngine>();
+        engine->setRandomSeed (1);
+
+        if (options.forceInstructionSet)
+            engine->setInstructionSet (options.instructionSet);
+
+        engine->prepare (c.sampleRate, c.blockSize, kNumChannels, GranularConstants::kMaxGrains);
+
+        if (options.multithreaded)
+            engine->startWorkerThreads();
+
+        EngineParams params;
+        params.density = c.density;
+        params.grainSizeMs = c.grainSizeMs;
+        params.pitchScatter = c.pitchScatter;
+        params.feedback = c.feedback;
+        params.shimmer = c.shimmer;
+        params.poolCapacity = GranularConstants::kMaxGrains;
+        params.multithreaded = options.multithreaded;
+
+        // The same noise every run, so cases compare across builds
+        juce::Random random (12345);
+        juce::AudioBuffer<float> input (kNumChannels, c.blockSize * 64);
+        for (int ch = 0; ch < kNumChannels; ++ch)
+            for (int i = 0; i < input.getNumSamples(); ++i)
+                input.setSample (ch, i, random.nextFloat() - 0.5f);
+
+        juce::AudioBuffer<float> block (kNumChannels, c.blockSize);
+        int inputPos = 0;
+
+        const auto renderBlock = [&]
+        {
+            for (int ch = 0; ch < kNumChannels; ++ch)
+                block.copyFrom (ch, 0, input, ch, inputPos, c.blockSize);
+
+            inputPos = (inputPos + c.blockSize) % input.getNumSamples();
+            engine->process (block, params);
+        };
+
+        for (int n = 0; n < static_cast<int> (kWarmUpSeconds * c.sampleRate); n += c.blockSize)
+            renderBlock();
+
+        // The pool counters are cumulative, so only what the timed blocks add is reported
+        const auto stealsBefore = engine->getStats().steals;
+        const auto exhaustedBefore = engine->getStats().exhausted;
+
+        const int numBlocks = juce::jmax (1, static_cast<int> (options.seconds * c.sampleRate) / c.blockSize);
+        double activeSum = 0.0;
+        int peakActive = 0;
+        juce::int64 renderTicks = 0;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            renderBlock();
+            renderTicks += juce::Time::getHighResolutionTicks() - start;
+
+            const auto& stats = engine->getStats();
+            activeSum += stats.activeGrains;
+            peakActive = juce::jmax (peakActive, stats.activeGrains);
+        }
+
+        const auto& stats = engine->getStats();
+        const double wallSeconds = juce::Time::highResolutionTicksToSeconds (renderTicks);
+        const double numSamples = static_cast<double> (numBlocks) * c.blockSize;
+
+        BenchmarkResult result;
+        result.nsPerSample = wallSeconds * 1.0e9 / numSamples;
+        result.realtimeFactor = wallSeconds > 0.0 ? numSamples / c.sampleRate / wallSeconds : 0.0;
+        result.meanActiveGrains = activeSum / numBlocks;
+        result.peakActiveGrains = peakActive;
+        result.steals = stats.steals - stealsBefore;
+        result.exhausted = stats.exhausted - exhaustedBefore;
+        return result;
+    }
+
+    juce::var toVar (const BenchmarkCase& c, const BenchmarkResult& r)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty ("sampleRate", c.sampleRate);
+        object->setProperty ("blockSize", c.blockSize);
+        object->setProperty ("density", c.density);
+        object->setProperty ("grainSizeMs", c.grainSizeMs);
+        object->setProperty ("pitchScatter", c.pitchScatter);
+        object->setProperty ("feedback", c.feedback);
+        object->setProperty ("shimmer", c.shimmer);
+        object->setProperty ("nsPerSample", r.nsPerSample);
+        object->setProperty ("realtimeFactor", r.realtimeFactor);
+        object->setProperty ("meanActiveGrains", r.meanActiveGrains);
+        object->setProperty ("peakActiveGrains", r.peakActiveGrains);
+        object->setProperty ("steals", static_cast<juce::int64> (r.steals));
+        object->setProperty ("poolFull", static_cast<juce::int64> (r.exhausted));
+        return object;
+    }
+
+    bool parseInstructionSet (const juce::String& name, SimdKernels::InstructionSet& isa)
+    {
+        using IS = SimdKernels::InstructionSet;
+
+        for (auto candidate : { IS::Scalar, IS::SSE41, IS::AVX2, IS::AVX512 })
+        {
+            if (juce::String (SimdKernels::getName (candidate)).removeCharacters ("-.").equalsIgnoreCase (name.removeCharacters ("-.")))
+            {
+                isa = candidate;
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    const juce::ArgumentList args ("GranularBenchmark", argc, argv);
+    Options options;
+
+    options.quick = args.containsOption ("--quick");
+    options.multithreaded = args.containsOption ("--threads");
+
+    if (args.containsOption ("--seconds"))
+        options.seconds = juce::jmax (0.1, args.getValueForOption ("--seconds").getDoubleValue());
+
+    if (args.containsOption ("--isa"))
+    {
+        options.forceInstructionSet = parseInstructionSet (args.getValueForOption ("--isa"), options.instructionSet);
+        if (! options.forceInstructionSet)
+        {
+            std::fprintf (stderr, "Unknown instruction set: %s\n", args.getValueForOption ("--isa").toRawUTF8());
+            return 1;
+        }
+    }
+
+    if (args.containsOption ("--json"))
+        options.jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--json"));
+
+    const auto isa = options.forceInstructionSet ? SimdKernels::get (options.instructionSet).instructionSet
+                                                 : SimdKernels::get().instructionSet;
+    const auto cases = makeMatrix (options.quick);
+
+    std::printf ("GranularBenchmark: %d cases, %.1f s each, %s kernels%s\n",
+                 static_cast<int> (cases.size()), options.seconds, SimdKernels::getName (isa),
+                 options.multithreaded ? ", worker threads" : "");
+    std::printf ("%8s %6s %8s %8s %6s %6s %6s | %10s %9s %8s %6s\n",
+                 "rate", "block", "density", "size ms", "pitch", "fb", "shim",
+                 "ns/sample", "RT factor", "grains", "peak");
+
+    juce::Array<juce::var> results;
+
+    for (const auto& c : cases)
+    {
+        const auto r = runCase (c, options);
+        results.add (toVar (c, r));
+
+        std::printf ("%8.0f %6d %8.0f %8.0f %6.0f %6.2f %6.0f | %10.2f %9.1f %8.1f %6d\n",
+                     c.sampleRate, c.blockSize, c.density, c.grainSizeMs, c.pitchScatter, c.feedback, c.shimmer,
+                     r.nsPerSample, r.realtimeFactor, r.meanActiveGrains, r.peakActiveGrains);
+        std::fflush (stdout);
+    }
+
+    if (options.jsonFile != juce::File())
+    {
+        auto* report = new juce::DynamicObject();
+        report->setProperty ("benchmark", "GranularBenchmark");
+        report->setProperty ("version", 1);
+        report->setProperty ("date", juce::Time::getCurrentTime().toISO8601 (true));
+        report->setProperty ("cpu", juce::SystemStats::getCpuModel());
+        report->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+        report->setProperty ("instructionSet", SimdKernels::getName (isa));
+        report->setProperty ("workerThreads", options.multithreaded);
+        report->setProperty ("secondsPerCase", options.seconds);
+        report->setProperty ("results", results);
+
+        if (! options.jsonFile.replaceWithText (juce::JSON::toString (juce::var (report))))
+        {
+            std::fprintf (stderr, "Could not write %s\n", options.jsonFile.getFullPathName().toRawUTF8());
+            return 1;
+        }
+
+        std::printf ("Wrote %s\n", options.jsonFile.getFullPathName().toRawUTF8());
+    }
+
+    return 0;
+}
@@ -2,6 +2,15 @@
   ==============================================================================
     CircularBuffer.h
     Ring buffer with freeze support and fractional-sample reading.
+    Storage is a power-of-two ring of interleaved stereo frames with guard
+    frames, so positions wrap with a bitmask and every interpolation window,
+    for both channels, is one contiguous read.
+    Reads come in three qualities: linear, 4-point Hermite, and windowed
+    sinc (16 to 128 taps) band-limited to the grain's playback rate. Hermite reads
+    run in bulk through SimdKernels over the raw Ring view.
+    The ring also keeps half-band filtered, decimated octave levels, so a
+    grain pitched up by k octaves can read level k at 1/2^k of its rate
+    without aliasing.
   ==============================================================================
 */
 
@@ -9,11 +18,40 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include "../Utils/Constants.h"
+#include "SincTable.h"
+#include <algorithm>
+#include <cmath>
+#include <array>
 #include <vector>
 
+#if JUCE_USE_SSE_INTRINSICS
+ #include <xmmintrin.h>
+#endif
+
+enum class InterpolationQuality
+{
+    Linear = 0,
+    Hermite,
+    Sinc,
+    Octaves     // Hermite from the octave level matching the playback rate
+};
+
 class CircularBuffer
 {
 public:
+    /** Extra frames stored around the ring so the widest (sinc) window never
+        wraps: copies of the last frames before index 0, and of the first
+        frames after the end. */
+    static constexpr int kGuardBefore = SincTable::kMaxTaps / 2 - 1;
+    static constexpr int kGuardAfter  = SincTable::kMaxTaps / 2;
+
+    /** Samples per stored frame. Mono input uses the left slot only. */
+    static constexpr int kFrameSize = 2;
+
+    /** Decimated levels kept besides the full-rate ring (octave k is 1/2^k rate).
+        Together they need less memory than the full-rate ring itself. */
+    static constexpr int kNumOctaves = 3;
+
     CircularBuffer() = default;
 
     void prepare (double sampleRate, int numChannels, float maxLengthSeconds)
@@ -21,81 +59,309 @@ public:
         sr = sampleRate;
         channels = numChannels;
         maxSamples = static_cast<int> (sr * maxLengthSeconds);
-        buffer.setSize (channels, maxSamples);
-        buffer.clear();
+        // Every octave level must hold at least its guard frames
+        capacity = juce::nextPowerOfTwo (juce::jmax (kGuardAfter << kNumOctaves, maxSamples));
+        mask = capacity - 1;
+
+        for (int k = 0; k <= kNumOctaves; ++k)
+        {
+            auto& level = levels[static_cast<size_t> (k)];
+            level.capacity = capacity >> k;
+            level.mask = level.capacity - 1;
+            level.frames.assign (static_cast<size_t> ((kGuardBefore + level.capacity + kGuardAfter) * kFrameSize), 0.0f);
+            level.written = 0;
+        }
+
         writePos = 0;
         activeSamples = maxSamples;
     }
 
+    /** Set how far back grains may reach. The storage always wraps at the
+        power-of-two capacity; readers treat the lengthSeconds behind the write
+        head as the ring (see getWindowPosition), so scatter and the frozen loop
+        stay within Buffer Length. */
     void setBufferLength (float lengthSeconds)
     {
         activeSamples = juce::jlimit (1, maxSamples,
                                       static_cast<int> (sr * lengthSeconds));
     }
 
-    void writeSample (int channel, float sample)
+    /** Write a block of input at the write head and advance it. The block is
+        split at most once, where it crosses the end of the ring. The octave
+        levels are then decimated up to the new frames, so grains reading them
+        see the same audio as the full-rate ring. */
+    void writeBlock (const float* const* channelData, int numChannels, int numSamples)
     {
         if (frozen) return;
-        buffer.setSample (channel, writePos % activeSamples, sample);
+
+        auto& level = levels[0];
+        forEachRun (writePos, numSamples, [&] (int pos, int offset, int length)
+        {
+            for (int ch = 0; ch < juce::jmin (numChannels, kFrameSize); ++ch)
+            {
+                const float* src = channelData[ch] + offset;
+                float* dst = level.frames.data() + (pos + kGuardBefore) * kFrameSize + ch;
+
+                for (int i = 0; i < length; ++i)
+                    dst[i * kFrameSize] = src[i];
+            }
+        });
+
+        writePos = (writePos + numSamples) & mask;
+        level.written += numSamples;
+        updateGuards (level);
+        updateOctaves();
     }
 
-    void advanceWritePosition()
+    /** Mix gain * block into the ring starting at startPos (e.g. feedback into
+        the frames a previous writeBlock filled), and decimate the octave samples
+        that depend on those frames again. */
+    void addBlock (int startPos, const float* const* channelData, int numChannels, int numSamples, float gain)
     {
         if (frozen) return;
-        writePos = (writePos + 1) % activeSamples;
+
+        auto& level = levels[0];
+        forEachRun (startPos & mask, numSamples, [&] (int pos, int offset, int length)
+        {
+            for (int ch = 0; ch < juce::jmin (numChannels, kFrameSize); ++ch)
+            {
+                const float* src = channelData[ch] + offset;
+                float* dst = level.frames.data() + (pos + kGuardBefore) * kFrameSize + ch;
+
+                for (int i = 0; i < length; ++i)
+                    dst[i * kFrameSize] += src[i] * gain;
+            }
+        });
+
+        updateGuards (level);
+        rewindOctaves (level.written - ((writePos - startPos) & mask));
+        updateOctaves();
     }
 
-    /** Read with Hermite interpolation at a fractional sample position */
-    float readSample (int channel, float fractionalPos) const
+    /** Wrap any fractional position into [0, capacity). */
+    double wrapPosition (double fractionalPos) const
     {
-        const int len = activeSamples;
-        const float normalised = std::fmod (fractionalPos, static_cast<float> (len));
-        const float pos = normalised < 0.0f ? normalised + static_cast<float> (len) : normalised;
+        const double whole = std::floor (fractionalPos);
+        return static_cast<double> (static_cast<juce::int64> (whole) & mask) + (fractionalPos - whole);
+    }
 
-        const int i0 = static_cast<int> (pos);
-        const float frac = pos - static_cast<float> (i0);
+    /** Position in the active window: frames from the oldest frame still in it
+        (Buffer Length behind the write head), wrapped into [0, activeLength). */
+    double getWindowPosition (double fractionalPos) const
+    {
+        const double fromOldest = wrapPosition (fractionalPos - static_cast<double> (writePos - activeSamples));
+        return std::fmod (fromOldest, static_cast<double> (activeSamples));
+    }
 
-        // 4-point Hermite interpolation
-        const int im1 = (i0 - 1 + len) % len;
-        const int i1  = (i0 + 1) % len;
-        const int i2  = (i0 + 2) % len;
+    /** Octave level to read for a grain at the given playback rate (|rate|):
+        the largest k with rate >= 2^k, so the rate at that level stays in [1, 2). */
+    static int getOctaveForRate (float playbackRate)
+    {
+        int octave = 0;
+        while (octave < kNumOctaves && playbackRate >= static_cast<float> (2 << octave))
+            ++octave;
+        return octave;
+    }
 
-        const float ym1 = buffer.getSample (channel, im1);
-        const float y0  = buffer.getSample (channel, i0);
-        const float y1  = buffer.getSample (channel, i1);
-        const float y2  = buffer.getSample (channel, i2);
+    /** Raw view of one octave level for the bulk readers in SimdKernels: frame p
+        starts at frames + (p & mask) * kFrameSize, and the guard frames keep the
+        next kGuardAfter frames contiguous. */
+    struct Ring
+    {
+        const float* frames = nullptr;
+        int mask = 0;
+    };
 
-        // Hermite interpolation formula
-        const float c0 = y0;
-        const float c1 = 0.5f * (y1 - ym1);
-        const float c2 = ym1 - 2.5f * y0 + 2.0f * y1 - 0.5f * y2;
-        const float c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+    Ring getRing (int octave = 0) const
+    {
+        const auto& level = levels[static_cast<size_t> (octave)];
+        return { level.frames.data() + kGuardBefore * kFrameSize, level.mask };
+    }
 
-        return ((c3 * frac + c2) * frac + c1) * frac + c0;
+    /** Read with linear interpolation (cheapest, softest). */
+    float readSampleLinear (int channel, int whole, float frac) const
+    {
+        const float* y = frameAt (0, whole) + channel;
+        return y[0] + frac * (y[kFrameSize] - y[0]);
     }
 
-    /** Write feedback signal into the buffer at a specific position (adds to existing content). */
-    void writeFeedbackAt (int channel, int position, float sample)
+    void readStereoLinear (int whole, float frac, float& left, float& right) const
     {
-        if (frozen) return;
-        const int pos = ((position % activeSamples) + activeSamples) % activeSamples;
-        const float existing = buffer.getSample (channel, pos);
-        // Soft-limit feedback to prevent runaway
-        const float combined = existing + sample;
-        buffer.setSample (channel, pos, combined);
+        const float* y = frameAt (0, whole);
+        left  = y[0] + frac * (y[2] - y[0]);
+        right = y[1] + frac * (y[3] - y[1]);
+    }
+
+    /** Band-limited read: a windowed-sinc kernel from the bank that
+        SincTable::getBank picked for the grain's playback rate. */
+    float readSampleSinc (int channel, int whole, float frac, const SincTable::Bank& bank) const
+    {
+        const float* w = SincTable::getKernel (bank, frac);
+        const float* y = sincWindowAt (whole, bank.taps) + channel;
+
+        float sum = 0.0f;
+        for (int k = 0; k < bank.taps; ++k)
+            sum += w[k] * y[k * kFrameSize];
+
+        return sum;
+    }
+
+    void readStereoSinc (int whole, float frac, const SincTable::Bank& bank, float& left, float& right) const
+    {
+        const float* w = SincTable::getKernel (bank, frac);
+        const float* y = sincWindowAt (whole, bank.taps);
+
+       #if JUCE_USE_SSE_INTRINSICS
+        // Each 4-float load holds two frames (L R L R); duplicate the matching weights.
+        // Every bank's tap count is a multiple of 4.
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < bank.taps; k += 4)
+        {
+            const __m128 w4 = _mm_loadu_ps (w + k);
+            acc = _mm_add_ps (acc, _mm_mul_ps (_mm_loadu_ps (y + 2 * k),     _mm_unpacklo_ps (w4, w4)));
+            acc = _mm_add_ps (acc, _mm_mul_ps (_mm_loadu_ps (y + 2 * k + 4), _mm_unpackhi_ps (w4, w4)));
+        }
+        const __m128 lr = _mm_add_ps (acc, _mm_movehl_ps (acc, acc));
+        left  = _mm_cvtss_f32 (lr);
+        right = _mm_cvtss_f32 (_mm_shuffle_ps (lr, lr, _MM_SHUFFLE (1, 1, 1, 1)));
+       #else
+        float sumL = 0.0f, sumR = 0.0f;
+        for (int k = 0; k < bank.taps; ++k)
+        {
+            sumL += w[k] * y[2 * k];
+            sumR += w[k] * y[2 * k + 1];
+        }
+        left = sumL;
+        right = sumR;
+       #endif
     }
 
     int getWritePosition() const { return writePos; }
     int getActiveLength()  const { return activeSamples; }
+    int getCapacity()      const { return capacity; }
     double getSampleRate() const { return sr; }
     bool isFrozen()        const { return frozen; }
+
     void setFrozen (bool shouldFreeze) { frozen = shouldFreeze; }
 
 private:
-    juce::AudioBuffer<float> buffer;
+    /** One ring of interleaved frames. Level 0 is the full-rate buffer. */
+    struct Level
+    {
+        std::vector<float> frames;  // interleaved L/R, guard frames at both ends
+        int capacity = 0;
+        int mask = 0;
+        juce::int64 written = 0;    // frames produced since prepare
+    };
+
+    /** 11-tap half-band decimation filter (6-point Lagrange), taps at 0, +-1, +-3, +-5. */
+    static constexpr float kHalfBandCentre = 0.5f;
+    static constexpr float kHalfBand1 = 150.0f / 512.0f;
+    static constexpr float kHalfBand3 = -25.0f / 512.0f;
+    static constexpr float kHalfBand5 = 3.0f / 512.0f;
+    static constexpr int   kHalfBandReach = 5;
+
+    /** First sample of the stored frame at (unwrapped) index pos of an octave
+        level. Guard frames make the following kGuardAfter frames readable
+        without wrapping. */
+    const float* frameAt (int octave, int pos) const
+    {
+        const auto& level = levels[static_cast<size_t> (octave)];
+        return level.frames.data() + ((pos & level.mask) + kGuardBefore) * kFrameSize;
+    }
+
+    /** First frame of the numTaps sinc window around whole. The centre is wrapped,
+        so the taps before it run into the guard frames before the ring and the
+        taps after it into the guard frames after it. */
+    const float* sincWindowAt (int whole, int numTaps) const
+    {
+        return frameAt (0, whole) - (numTaps / 2 - 1) * kFrameSize;
+    }
+
+    /** Mark the octave samples whose filter taps reach level-0 frame firstChanged
+        (counted since prepare) or later as not yet produced. */
+    void rewindOctaves (juce::int64 firstChanged)
+    {
+        for (int k = 1; k <= kNumOctaves; ++k)
+        {
+            // Sample j reads source samples from 2j - 5 to 2j + 5
+            firstChanged = juce::jmax (juce::int64 (0), (firstChanged - kHalfBandReach + 1) / 2);
+
+            auto& level = levels[static_cast<size_t> (k)];
+            level.written = juce::jmin (level.written, firstChanged);
+        }
+    }
+
+    /** Produce every octave sample whose filter taps are now available on the
+        level above. Each level costs half the previous one per block. */
+    void updateOctaves()
+    {
+        for (int k = 1; k <= kNumOctaves; ++k)
+        {
+            const auto& source = levels[static_cast<size_t> (k - 1)];
+            auto& dest = levels[static_cast<size_t> (k)];
+
+            // Sample j is centred on source sample 2j and needs source samples up to 2j + 5
+            const juce::int64 available = juce::jmax (juce::int64 (0), (source.written - kHalfBandReach + 1) / 2);
+            if (available <= dest.written)
+                continue;
+
+            const float* src = source.frames.data();
+
+            for (juce::int64 j = dest.written; j < available; ++j)
+            {
+                const int centre = static_cast<int> (2 * j);
+                float* out = dest.frames.data() + ((static_cast<int> (j) & dest.mask) + kGuardBefore) * kFrameSize;
+
+                auto tap = [&] (int offset, int ch)
+                {
+                    return src[(((centre + offset) & source.mask) + kGuardBefore) * kFrameSize + ch];
+                };
+
+                for (int ch = 0; ch < kFrameSize; ++ch)
+                    out[ch] = kHalfBandCentre * tap (0, ch)
+                            + kHalfBand1 * (tap (-1, ch) + tap (1, ch))
+                            + kHalfBand3 * (tap (-3, ch) + tap (3, ch))
+                            + kHalfBand5 * (tap (-5, ch) + tap (5, ch));
+            }
+
+            dest.written = available;
+            updateGuards (dest);
+        }
+    }
+
+    /** Call run (ringIndex, blockOffset, length) for the one or two contiguous
+        runs that numSamples frames starting at ring index pos occupy. */
+    template <typename RunFunc>
+    void forEachRun (int pos, int numSamples, RunFunc&& run) const
+    {
+        const int first = juce::jmin (numSamples, capacity - pos);
+        run (pos, 0, first);
+
+        if (first < numSamples)
+            run (0, first, numSamples - first);
+    }
+
+    /** Refresh the guard copies of a level's first and last frames. */
+    static void updateGuards (Level& level)
+    {
+        float* data = level.frames.data();
+
+        std::copy (data + kGuardBefore * kFrameSize,
+                   data + (kGuardBefore + kGuardAfter) * kFrameSize,
+                   data + (kGuardBefore + level.capacity) * kFrameSize);
+
+        std::copy (data + level.capacity * kFrameSize,
+                   data + (level.capacity + kGuardBefore) * kFrameSize,
+                   data);
+    }
+
+    std::array<Level, kNumOctaves + 1> levels;
     double sr = 44100.0;
     int channels = 2;
     int maxSamples = 0;
+    int capacity = 0;
+    int mask = 0;
     int activeSamples = 0;
     int writePos = 0;
     bool frozen = false;
@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+    CpuGovernor.h
+    Keeps the engine inside its block deadline by trading quality for time.
+    The engine reports how long each process() call took; the governor keeps
+    an exponential moving average of that time over the block's duration and
+    steps quality down when the average nears the budget, and back up, in the
+    reverse order, once there is headroom again.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "EngineParams.h"
+#include "../Utils/Constants.h"
+#include <juce_core/juce_core.h>
+#include <cmath>
+
+class CpuGovernor
+{
+public:
+    /** Quality steps, each including the ones before it. */
+    enum Level
+    {
+        FullQuality = 0,
+        LinearInterpolation,   // interpolation drops to Linear
+        GrainLimit,            // density capped to about half the grains playing when engaged
+        NoShimmer,             // shimmer, the costliest part of the post chain, bypassed
+        SlowControlRate,       // LFO, spawn and smoothing updates at a quarter of the rate
+        kNumLevels
+    };
+
+    void prepare (double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    void reset()
+    {
+        level = FullQuality;
+        averageLoad = 0.0;
+        secondsSinceChange = 0.0;
+        restoreHoldSec = kRestoreHoldSec;
+        grainLimit = GranularConstants::kMaxGrains;
+    }
+
+    /** Feed one process() call: its wall time and length, and the grains playing
+        at its end. Disabled governors only track the load. */
+    void update (double elapsedSeconds, int numSamples, int activeGrains, bool enabled)
+    {
+        if (numSamples <= 0)
+            return;
+
+        const double blockSeconds = numSamples / sampleRate;
+        const double load = elapsedSeconds / blockSeconds;
+        averageLoad += (1.0 - std::exp (-blockSeconds / kAverageTimeSec)) * (load - averageLoad);
+        secondsSinceChange += blockSeconds;
+
+        if (! enabled)
+        {
+            level = FullQuality;
+            return;
+        }
+
+        if (averageLoad > kDegradeLoad && level < kNumLevels - 1 && secondsSinceChange >= kDegradeHoldSec)
+        {
+            // Back-off: a restore that had to be undone soon after waits longer next time
+            if (secondsSinceChange < restoreHoldSec && lastChangeWasRestore)
+                restoreHoldSec = juce::jmin (kMaxRestoreHoldSec, restoreHoldSec * 2.0);
+
+            if (level + 1 == GrainLimit)
+                grainLimit = juce::jmax (kMinGrainLimit, activeGrains / 2);
+
+            setLevel (level + 1, false);
+        }
+        else if (averageLoad < kRestoreLoad && level > FullQuality && secondsSinceChange >= restoreHoldSec)
+        {
+            setLevel (level - 1, true);
+        }
+        else if (level == FullQuality && secondsSinceChange >= kMaxRestoreHoldSec)
+        {
+            restoreHoldSec = kRestoreHoldSec;
+        }
+    }
+
+    /** The parameters to render the next block with: params, degraded to the current level. */
+    EngineParams apply (const EngineParams& params) const
+    {
+        EngineParams result = params;
+
+        if (level >= LinearInterpolation)
+            result.interpolation = InterpolationQuality::Linear;
+
+        if (level >= GrainLimit)
+        {
+            const float grainSeconds = juce::jmax (GranularConstants::kMinGrainSizeMs, params.grainSizeMs) / 1000.0f;
+            result.density = juce::jmin (params.density, static_cast<float> (grainLimit) / grainSeconds / params.densityScale);
+        }
+
+        if (level >= NoShimmer)
+            result.shimmer = 0.0f;
+
+        if (level >= SlowControlRate)
+            result.controlBlockSize = params.controlBlockSize * kSlowControlFactor;
+
+        return result;
+    }
+
+    int getLevel() const { return level; }
+
+    /** Smoothed process() time as a fraction of the block duration. */
+    double getAverageLoad() const { return averageLoad; }
+
+private:
+    static constexpr double kAverageTimeSec     = 0.1;    // EMA time constant
+    static constexpr double kDegradeLoad        = 0.75;   // step down above this share of the deadline
+    static constexpr double kRestoreLoad        = 0.4;    // step back up below this
+    static constexpr double kDegradeHoldSec     = 0.2;    // let the last step show in the average first
+    static constexpr double kRestoreHoldSec     = 1.0;
+    static constexpr double kMaxRestoreHoldSec  = 16.0;
+    static constexpr int    kMinGrainLimit      = 16;
+    static constexpr int    kSlowControlFactor  = 4;
+
+    void setLevel (int newLevel, bool isRestore)
+    {
+        level = newLevel;
+        lastChangeWasRestore = isRestore;
+        secondsSinceChange = 0.0;
+    }
+
+    double sampleRate = 44100.0;
+    int level = FullQuality;
+    double averageLoad = 0.0;
+    double secondsSinceChange = 0.0;
+    double restoreHoldSec = kRestoreHoldSec;
+    bool lastChangeWasRestore = false;
+    int grainLimit = GranularConstants::kMaxGrains;
+};
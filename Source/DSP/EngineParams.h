@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+    EngineParams.h
+    Plain snapshot of every engine parameter, in engine units. The processor
+    fills one per block from cached parameter pointers; the engine never sees
+    the AudioProcessorValueTreeState, so it can also run headless.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "CircularBuffer.h"
+#include "GrainEnvelope.h"
+#include "GrainScheduler.h"
+#include "LFOModulator.h"
+#include "RandomGenerator.h"
+#include "../Utils/Constants.h"
+
+struct EngineParams
+{
+    // Core grain
+    float grainSizeMs  = GranularConstants::kDefaultGrainSize;
+    float density      = GranularConstants::kDefaultDensity;   // grains per second, before densityScale
+    float densityScale = 1.0f;                                 // Density Range multiplier
+    SpawnMode spawnMode = SpawnMode::Synchronous;
+    float position     = 50.0f;                                // % of buffer back from the write head
+    float pitch        = 0.0f;                                 // semitones
+    float pan          = 0.0f;                                 // -1..1
+
+    // Scatter (%)
+    float posScatter   = 20.0f;
+    float pitchScatter = 0.0f;
+    float panScatter   = 30.0f;
+    ScatterDistribution scatterShape = ScatterDistribution::Uniform;
+
+    // Envelope
+    float attack       = 25.0f;                                // % of grain
+    float decay        = 25.0f;                                // % of grain
+    EnvelopeShape envShape = EnvelopeShape::Hanning;
+
+    // Effects
+    bool  freeze       = false;
+    bool  reverse      = false;
+    float feedback     = 0.0f;                                 // 0..kMaxFeedback
+    float shimmer      = 0.0f;                                 // %
+    float lowCut       = 20.0f;                                // Hz
+    float highCut      = 20000.0f;                             // Hz
+
+    // LFO
+    float lfoRate      = 1.0f;                                 // Hz
+    float lfoDepth     = 0.0f;                                 // %
+    LFOShape  lfoShape  = LFOShape::Sine;
+    LFOTarget lfoTarget = LFOTarget::Position;
+
+    // Output
+    float stereoWidth  = 100.0f;                               // %
+    float outputLevelDb = 0.0f;
+    float dryWet       = 50.0f;                                // %
+    float bufferLengthSec = GranularConstants::kDefaultBufferSec;
+
+    // Engine
+    InterpolationQuality interpolation = InterpolationQuality::Hermite;
+    int poolCapacity = GranularConstants::kDefaultPoolCapacity;   // grains, up to kMaxGrains
+    StealPolicy stealPolicy = StealPolicy::Oldest;
+    bool multithreaded = false;   // render on worker threads when the load is high enough
+    bool pipelined = false;       // render one block ahead on a separate thread (processor level)
+    bool adaptiveQuality = false; // let the CPU governor trade quality for time
+    int controlBlockSize = GranularConstants::kControlBlockSize;   // samples per control update
+};
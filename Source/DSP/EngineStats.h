@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+    EngineStats.h
+    Always-on performance counters for GranularEngine: time per processing
+    stage, a histogram of process() time against the block deadline, and
+    grain pool activity. The engine fills them on the audio thread and
+    publishes a copy per block through a TripleBuffer, like GrainVisualData.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../Utils/TraceRecorder.h"
+#include <juce_core/juce_core.h>
+#include <array>
+
+struct EngineStats
+{
+    enum Stage
+    {
+        BufferWrite = 0,   // block setup and the circular buffer write
+        Scheduling,        // control-rate updates and spawn decisions
+        GrainRender,       // grain kernels and normalisation
+        PostProcess,       // PostProcessor chain
+        Feedback,          // feedback into the circular buffer
+        Mix,               // dry/wet, output level and visualizer data
+        kNumStages
+    };
+
+    static const char* getStageName (int stage)
+    {
+        static constexpr const char* names[] = { "Buffer write", "Scheduling", "Grain render",
+                                                 "Post process", "Feedback", "Mix" };
+        return names[stage];
+    }
+
+    /** Load bins are 10% of the deadline wide; the last one counts overruns. */
+    static constexpr int kNumLoadBins = 11;
+
+    std::array<double, kNumStages> stageMicros {};   // averaged time per block
+    double blockMicros    = 0.0;                      // averaged process() time
+    double deadlineMicros = 0.0;                      // duration of the last block
+    double peakLoad       = 0.0;                      // worst process() time / deadline
+    std::array<juce::uint32, kNumLoadBins> loadHistogram {};
+    juce::uint64 numBlocks = 0;
+
+    // Grain pool, counted since prepare or reset
+    juce::uint64 spawns    = 0;
+    juce::uint64 steals    = 0;
+    juce::uint64 exhausted = 0;   // spawns that found the pool full
+    int activeGrains     = 0;
+    int peakActiveGrains = 0;
+    int poolCapacity     = 0;
+
+    int governorLevel = 0;        // CpuGovernor::Level
+};
+
+/** Lap timer that splits one process() call into EngineStats stages. */
+class EngineProfiler
+{
+public:
+    void reset()
+    {
+        stats = {};
+    }
+
+    void beginBlock()
+    {
+        blockStart = lapStart = juce::Time::getHighResolutionTicks();
+        laps.fill (0);
+    }
+
+    /** Book the time since the previous lap (or beginBlock) to stage, and trace
+        it as an event when trace recording is on. */
+    void lap (EngineStats::Stage stage)
+    {
+        const auto now = juce::Time::getHighResolutionTicks();
+        laps[static_cast<size_t> (stage)] += now - lapStart;
+        TraceRecorder::record (EngineStats::getStageName (stage), "engine", lapStart, now);
+        lapStart = now;
+    }
+
+    /** Close the block and fold it into the stats. Returns its wall time in seconds. */
+    double endBlock (int numSamples, double sampleRate)
+    {
+        const auto endTicks = juce::Time::getHighResolutionTicks();
+        const auto elapsedTicks = endTicks - blockStart;
+        TraceRecorder::record ("Engine process", "engine", blockStart, endTicks);
+
+        const double elapsed = juce::Time::highResolutionTicksToSeconds (elapsedTicks);
+        const double deadline = numSamples / sampleRate;
+
+        // Averages settle over about kAverageBlocks blocks
+        const double weight = stats.numBlocks == 0 ? 1.0 : 1.0 / kAverageBlocks;
+
+        for (size_t s = 0; s < laps.size(); ++s)
+            stats.stageMicros[s] += weight * (juce::Time::highResolutionTicksToSeconds (laps[s]) * 1.0e6 - stats.stageMicros[s]);
+
+        stats.blockMicros += weight * (elapsed * 1.0e6 - stats.blockMicros);
+        stats.deadlineMicros = deadline * 1.0e6;
+
+        const double load = deadline > 0.0 ? elapsed / deadline : 0.0;
+        stats.peakLoad = juce::jmax (stats.peakLoad, load);
+        ++stats.loadHistogram[static_cast<size_t> (juce::jlimit (0, EngineStats::kNumLoadBins - 1,
+                                                                 static_cast<int> (load * 10.0)))];
+        ++stats.numBlocks;
+
+        return elapsed;
+    }
+
+    EngineStats& getStats() { return stats; }
+
+private:
+    static constexpr double kAverageBlocks = 64.0;
+
+    EngineStats stats;
+    std::array<juce::int64, EngineStats::kNumStages> laps {};
+    juce::int64 blockStart = 0;
+    juce::int64 lapStart = 0;
+};
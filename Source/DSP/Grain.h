@@ -1,7 +1,8 @@
 /*
   ==============================================================================
     Grain.h
-    Single grain structure — lightweight POD-style, no virtual functions.
+    Spawn description of a single grain — lightweight POD-style, no virtual
+    functions. Per-sample playback state lives in GrainPool's render lanes.
   ==============================================================================
 */
 
@@ -11,15 +12,19 @@
 
 struct Grain
 {
-    bool   active       = false;
-
     // Read position in the circular buffer (fractional samples)
-    float  startPos     = 0.0f;
-    float  currentPos   = 0.0f;
+    double startPos     = 0.0;
 
     // Duration in samples
     int    lengthSamples = 0;
-    int    currentSample = 0;
+
+    // Fraction of a sample [0, 1) the grain started before its first rendered sample
+    float  onsetDelay   = 0.0f;
+
+    // Onset in samples since the scheduler was reset, and spawn position as
+    // % of the buffer behind the write head (used to pick steal victims)
+    double onsetTime    = 0.0;
+    float  lookback     = 0.0f;
 
     // Playback rate (1.0 = original pitch, 2.0 = octave up, 0.5 = octave down)
     float  playbackRate = 1.0f;
@@ -27,56 +32,15 @@ struct Grain
     // Panning (-1 = left, 0 = center, 1 = right)
     float  pan          = 0.0f;
 
-    // Envelope
+    // Envelope (envTable is bound from GrainEnvelope::TableBank at spawn)
     float  attackFrac   = 0.25f;
     float  decayFrac    = 0.25f;
-    EnvelopeShape envShape = EnvelopeShape::Hanning;
+    const float* envTable = nullptr;
+    GrainEnvelope::Family envFamily = GrainEnvelope::Family::Wavetable;
 
     // Reverse playback
     bool   reversed     = false;
 
     // Gain (applied after envelope)
     float  gain         = 1.0f;
-
-    /** Get the normalised position within the grain [0, 1] */
-    float getNormalisedPosition() const
-    {
-        return lengthSamples > 0 ? static_cast<float> (currentSample) / static_cast<float> (lengthSamples) : 0.0f;
-    }
-
-    /** Get the current envelope amplitude */
-    float getEnvelopeAmplitude() const
-    {
-        return GrainEnvelope::getAmplitude (getNormalisedPosition(), attackFrac, decayFrac, envShape);
-    }
-
-    /** Get the current read position in the circular buffer */
-    float getReadPosition() const
-    {
-        if (reversed)
-            return startPos - static_cast<float> (currentSample) * playbackRate;
-        else
-            return startPos + static_cast<float> (currentSample) * playbackRate;
-    }
-
-    /** Advance the grain by one sample, returns false when grain is done */
-    bool advance()
-    {
-        if (! active) return false;
-        ++currentSample;
-        if (currentSample >= lengthSamples)
-        {
-            active = false;
-            return false;
-        }
-        return true;
-    }
-
-    /** Reset the grain to inactive */
-    void reset()
-    {
-        active = false;
-        currentSample = 0;
-        lengthSamples = 0;
-    }
 };
@@ -1,71 +1,239 @@
 /*
   ==============================================================================
     GrainEnvelope.h
-    Window functions for grain amplitude envelopes.
+    Window functions for grain amplitude envelopes, precomputed into a bank of
+    interpolated lookup tables.
+
+    A grain's envelope is a linear attack / sustain / decay ramp u in [0, 1],
+    passed through the shape's curve s(u). Every shape, including the user-drawn
+    one, is stored as a table of s(u), so the per-sample cost is a ramp and one
+    interpolated lookup regardless of the shape.
   ==============================================================================
 */
 
 #pragma once
 
 #include <cmath>
+#include <array>
 #include <juce_core/juce_core.h>
+#include "../Utils/Constants.h"
 
 enum class EnvelopeShape
 {
     Hanning = 0,
     Gaussian,
     Triangle,
-    Trapezoid
+    Trapezoid,
+    Tukey,
+    BlackmanHarris,
+    Kaiser,
+    ExpDecay,
+    Custom
 };
 
 namespace GrainEnvelope
 {
-    /** Get envelope amplitude at normalised position [0, 1], with attack/decay fractions. */
-    inline float getAmplitude (float normPos, float attackFrac, float decayFrac, EnvelopeShape shape)
+    constexpr int kNumShapes = static_cast<int> (EnvelopeShape::Custom) + 1;
+    constexpr int kTableSize = 1024;
+
+    /** s(u) sampled at u = i / kTableSize, plus a guard point for interpolation at u = 1. */
+    using Table = std::array<float, kTableSize + 2>;
+
+    /** How a shape is evaluated per sample. Triangle's curve is s(u) = u, so its
+        grains skip the table lookup and use the ramp directly. */
+    enum class Family
     {
-        // Clamp
-        normPos    = juce::jlimit (0.0f, 1.0f, normPos);
-        attackFrac = juce::jlimit (0.01f, 0.99f, attackFrac);
-        decayFrac  = juce::jlimit (0.01f, 0.99f, decayFrac);
+        Wavetable = 0,
+        Ramp
+    };
 
-        // Ensure attack + decay don't exceed 1.0
-        const float totalEnv = attackFrac + decayFrac;
-        const float att = totalEnv > 1.0f ? attackFrac / totalEnv : attackFrac;
-        const float dec = totalEnv > 1.0f ? decayFrac / totalEnv : decayFrac;
+    constexpr int kNumFamilies = static_cast<int> (Family::Ramp) + 1;
+
+    inline Family getFamily (EnvelopeShape shape)
+    {
+        return shape == EnvelopeShape::Triangle ? Family::Ramp : Family::Wavetable;
+    }
 
-        float envGain = 1.0f;
+    /** Control points of the user-drawn curve, evenly spaced over u in [0, 1]. */
+    using CustomPoints = std::array<float, GranularConstants::kCustomEnvelopePoints>;
 
-        // Attack / sustain / decay regions
-        if (normPos < att)
-            envGain = normPos / att;
-        else if (normPos > (1.0f - dec))
-            envGain = (1.0f - normPos) / dec;
+    /** Zeroth-order modified Bessel function of the first kind (for the Kaiser window). */
+    inline double besselI0 (double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            const double t = x / (2.0 * k);
+            term *= t * t;
+            sum += term;
+        }
+        return sum;
+    }
+
+    /** Evaluate a built-in shape curve at ramp value u in [0, 1]. Only used to build tables. */
+    inline float evaluateShape (EnvelopeShape shape, float u)
+    {
+        const double x = juce::jlimit (0.0, 1.0, static_cast<double> (u));
+        const double pi = juce::MathConstants<double>::pi;
 
-        // Apply window shape to the linear ramp
         switch (shape)
         {
             case EnvelopeShape::Hanning:
-            {
                 // Apply cosine shaping to the linear envelope
-                return 0.5f * (1.0f - std::cos (juce::MathConstants<float>::pi * envGain));
-            }
+                return static_cast<float> (0.5 * (1.0 - std::cos (pi * x)));
+
             case EnvelopeShape::Gaussian:
-            {
                 // Gaussian with sigma ~ 0.4
-                const float x = (envGain - 1.0f);
-                return std::exp (-0.5f * (x * x) / (0.16f));
+                return static_cast<float> (std::exp (-0.5 * (x - 1.0) * (x - 1.0) / 0.16));
+
+            case EnvelopeShape::Trapezoid:
+                // Flatten the middle, steeper attack/decay
+                return static_cast<float> (juce::jmin (1.0, x * 1.5));
+
+            case EnvelopeShape::Tukey:
+                // Cosine taper over the first half of the ramp, flat top after it
+                return static_cast<float> (x < 0.5 ? 0.5 * (1.0 - std::cos (2.0 * pi * x)) : 1.0);
+
+            case EnvelopeShape::BlackmanHarris:
+            {
+                // Rising half of the 4-term Blackman-Harris window (coefficients sum to 1)
+                const double t = 0.5 * x;
+                return static_cast<float> (0.35875 - 0.48829 * std::cos (2.0 * pi * t)
+                                                   + 0.14128 * std::cos (4.0 * pi * t)
+                                                   - 0.01168 * std::cos (6.0 * pi * t));
             }
-            case EnvelopeShape::Triangle:
+
+            case EnvelopeShape::Kaiser:
             {
-                return envGain;
+                // Rising half of a Kaiser window (beta = 8), offset to start at zero
+                constexpr double beta = 8.0;
+                const double r = x - 1.0;
+                return static_cast<float> ((besselI0 (beta * std::sqrt (1.0 - r * r)) - 1.0) / (besselI0 (beta) - 1.0));
             }
-            case EnvelopeShape::Trapezoid:
+
+            case EnvelopeShape::ExpDecay:
             {
-                // Flatten the middle, steeper attack/decay
-                return juce::jlimit (0.0f, 1.0f, envGain * 1.5f);
+                // Exponential curvature: the decay ramp falls fast then tails off
+                constexpr double k = 5.0;
+                return static_cast<float> ((std::exp (k * x) - 1.0) / (std::exp (k) - 1.0));
             }
+
+            case EnvelopeShape::Triangle:
+            case EnvelopeShape::Custom:
             default:
-                return envGain;
+                return static_cast<float> (x);
         }
     }
+
+    inline void buildTable (EnvelopeShape shape, Table& table)
+    {
+        for (int i = 0; i <= kTableSize; ++i)
+            table[static_cast<size_t> (i)] = evaluateShape (shape, static_cast<float> (i) / static_cast<float> (kTableSize));
+
+        table[kTableSize + 1] = table[kTableSize];
+    }
+
+    /** Build a table by linear interpolation between user-drawn control points. */
+    inline void buildTable (const CustomPoints& points, Table& table)
+    {
+        const int lastPoint = static_cast<int> (points.size()) - 1;
+
+        for (int i = 0; i <= kTableSize; ++i)
+        {
+            const float x = static_cast<float> (i) * static_cast<float> (lastPoint) / static_cast<float> (kTableSize);
+            const int p0 = juce::jmin (static_cast<int> (x), lastPoint - 1);
+            const float frac = x - static_cast<float> (p0);
+            const float y0 = points[static_cast<size_t> (p0)];
+            const float y1 = points[static_cast<size_t> (p0 + 1)];
+            table[static_cast<size_t> (i)] = juce::jlimit (0.0f, 1.0f, y0 + frac * (y1 - y0));
+        }
+
+        table[kTableSize + 1] = table[kTableSize];
+    }
+
+    /** Sample a built-in shape at the custom control points (the default drawn curve). */
+    inline CustomPoints makeCustomPoints (EnvelopeShape shape)
+    {
+        CustomPoints points {};
+        const float lastPoint = static_cast<float> (points.size() - 1);
+
+        for (size_t i = 0; i < points.size(); ++i)
+            points[i] = evaluateShape (shape, static_cast<float> (i) / lastPoint);
+
+        return points;
+    }
+
+    /** Convert attack/decay fractions to the inverse ramp lengths used by ramp(). */
+    inline void getRampInverses (float attackFrac, float decayFrac, float& attackInv, float& decayInv)
+    {
+        attackFrac = juce::jlimit (0.01f, 0.99f, attackFrac);
+        decayFrac  = juce::jlimit (0.01f, 0.99f, decayFrac);
+
+        // Ensure attack + decay don't exceed 1.0
+        const float totalEnv = attackFrac + decayFrac;
+        attackInv = totalEnv > 1.0f ? totalEnv / attackFrac : 1.0f / attackFrac;
+        decayInv  = totalEnv > 1.0f ? totalEnv / decayFrac  : 1.0f / decayFrac;
+    }
+
+    /** Linear attack / sustain / decay ramp at normalised grain position [0, 1]. */
+    inline float ramp (float normPos, float attackInv, float decayInv)
+    {
+        normPos = juce::jlimit (0.0f, 1.0f, normPos);
+        return juce::jmin (1.0f, normPos * attackInv, (1.0f - normPos) * decayInv);
+    }
+
+    /** Interpolated table lookup at ramp value u in [0, 1]. */
+    inline float lookup (const float* table, float u)
+    {
+        const float x = u * static_cast<float> (kTableSize);
+        const int i = static_cast<int> (x);
+        const float frac = x - static_cast<float> (i);
+        return table[i] + frac * (table[i + 1] - table[i]);
+    }
+
+    /** Get envelope amplitude at normalised grain position [0, 1]. */
+    inline float getAmplitude (const float* table, float normPos, float attackInv, float decayInv)
+    {
+        return lookup (table, ramp (normPos, attackInv, decayInv));
+    }
+
+    /** One table per EnvelopeShape. The built-in shapes are computed once here.
+        The Custom shape has two tables that the audio thread flips between: a new
+        user-drawn curve is built into the spare one, so grains already playing
+        keep reading the table they spawned with. */
+    class TableBank
+    {
+    public:
+        TableBank()
+        {
+            for (int s = 0; s < kNumShapes; ++s)
+                buildTable (static_cast<EnvelopeShape> (s), tables[static_cast<size_t> (s)]);
+
+            setCustomPoints (makeCustomPoints (EnvelopeShape::Hanning));
+        }
+
+        const float* getTable (EnvelopeShape shape) const
+        {
+            const int index = juce::jlimit (0, kNumShapes - 1, static_cast<int> (shape));
+            if (index == static_cast<int> (EnvelopeShape::Custom))
+                return customTables[liveCustom].data();
+            return tables[static_cast<size_t> (index)].data();
+        }
+
+        /** The Custom table the next setCustomPoints() will overwrite. Only
+            rebuild it once no grain is still bound to it. */
+        const float* getSpareCustomTable() const { return customTables[1 - liveCustom].data(); }
+
+        /** Build the curve into the spare Custom table and make it the live one. */
+        void setCustomPoints (const CustomPoints& points)
+        {
+            buildTable (points, customTables[1 - liveCustom]);
+            liveCustom = 1 - liveCustom;
+        }
+
+    private:
+        std::array<Table, kNumShapes> tables;
+        std::array<Table, 2> customTables;
+        size_t liveCustom = 0;
+    };
 }
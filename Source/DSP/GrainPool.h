@@ -1,70 +1,325 @@
 /*
   ==============================================================================
     GrainPool.h
-    Pre-allocated pool of grains with free-list management.
+    Pre-allocated pool of grains. Spawn descriptions are kept per slot, while
+    the state touched per sample is stored as a structure of arrays.
+    Storage always covers kMaxCapacity grains; setCapacity() limits how many
+    slots are handed out, so resizing never allocates.
+    Free slots form an intrusive free-list and live slots a dense index list,
+    so spawn, release and iteration cost scales with live grains only.
+    When the pool is full, steal() fades out a victim chosen through indexed
+    heaps, so picking one is O(log n) whatever the policy.
   ==============================================================================
 */
 
 #pragma once
 
 #include "Grain.h"
+#include "IndexedHeap.h"
 #include "../Utils/Constants.h"
 #include <array>
+#include <cmath>
+#include <limits>
+
+/** Which grain gives way when a spawn finds the pool full. */
+enum class StealPolicy
+{
+    Off = 0,    // drop the new grain
+    Oldest,     // earliest onset
+    Quietest,   // least remaining energy: the grain that would end soonest
+    Furthest    // spawn position furthest from the current target position
+};
 
 class GrainPool
 {
 public:
+    /** Slots beyond the capacity that only stolen grains may occupy while they
+        fade, so the grain replacing them can start at once. */
+    static constexpr int kStealReserve = 64;
+
+    static constexpr int kMaxCapacity = GranularConstants::kMaxGrains + kStealReserve;
+
+    /** Read positions are 32.32 fixed point: integer sample index in the high
+        word, fraction in the low word. Resolution stays 2^-32 samples however
+        long the buffer is, and stepping a grain is one integer add. */
+    using Phase = juce::int64;
+    static constexpr int kPhaseFracBits = 32;
+
+    static Phase toPhase (double samples)  { return static_cast<Phase> (std::llround (samples * 4294967296.0)); }
+    static double fromPhase (Phase phase)  { return static_cast<double> (phase) / 4294967296.0; }
+    static int phaseIndex (Phase phase)    { return static_cast<int> (phase >> kPhaseFracBits); }
+    static float phaseFraction (Phase phase)
+    {
+        return static_cast<float> (static_cast<juce::uint32> (phase)) * (1.0f / 4294967296.0f);
+    }
+
+    /** Per-sample render state, one contiguous array per field, indexed by slot. */
+    struct Lanes
+    {
+        alignas (64) std::array<Phase, kMaxCapacity> phase {};         // current read position
+        alignas (64) std::array<Phase, kMaxCapacity> increment {};     // signed read increment per sample
+        alignas (64) std::array<float, kMaxCapacity> rate {};          // |playback rate|
+        alignas (64) std::array<float, kMaxCapacity> envIncrement {};  // envelope phase increment, 1 / length
+        alignas (64) std::array<float, kMaxCapacity> envOffset {};     // envelope phase of the sub-sample onset
+        alignas (64) std::array<float, kMaxCapacity> attackInv {};     // envelope ramp slopes, see GrainEnvelope::ramp
+        alignas (64) std::array<float, kMaxCapacity> decayInv {};
+        alignas (64) std::array<const float*, kMaxCapacity> envTable {}; // bound envelope table
+        alignas (64) std::array<GrainEnvelope::Family, kMaxCapacity> envFamily {};
+        alignas (64) std::array<float, kMaxCapacity> gainL {};         // gain * constant-power pan, left
+        alignas (64) std::array<float, kMaxCapacity> gainR {};         // gain * constant-power pan, right
+        alignas (64) std::array<int,   kMaxCapacity> elapsed {};       // samples rendered so far
+        alignas (64) std::array<int,   kMaxCapacity> length {};        // total length in samples
+        alignas (64) std::array<int,   kMaxCapacity> fadeStart {};     // elapsed count where a steal fade begins
+        alignas (64) std::array<float, kMaxCapacity> fadeInv {};       // 1 / steal fade length
+    };
+
+    static constexpr int kNoFade = std::numeric_limits<int>::max();
+
+    /** Pool activity since the last resetAll(), for EngineStats. */
+    struct Counters
+    {
+        juce::uint64 spawns    = 0;
+        juce::uint64 steals    = 0;
+        juce::uint64 exhausted = 0;   // spawn() calls that found the pool full
+    };
+
     GrainPool()
     {
-        for (auto& g : grains)
-            g.reset();
+        resetAll();
     }
 
-    /** Acquire a free grain from the pool. Returns nullptr if all are active. */
-    Grain* acquire()
+    /** Start a grain in a free slot. Returns the slot index, or -1 if the pool is full. */
+    int spawn (const Grain& params)
     {
-        for (auto& g : grains)
+        const int slot = freeHead;
+        if (slot < 0 || numActive - numFading >= capacity)
         {
-            if (! g.active)
+            ++counters.exhausted;
+            return -1;
+        }
+
+        const auto i = static_cast<size_t> (slot);
+        freeHead = nextFree[i];
+
+        grains[i] = params;
+
+        const float panAngle = (params.pan + 1.0f) * 0.5f; // 0-1
+        const double signedRate = params.reversed ? -params.playbackRate : params.playbackRate;
+
+        // A grain whose onset fell between samples is already onsetDelay samples in
+        lanes.phase[i]        = toPhase (params.startPos + params.onsetDelay * signedRate);
+        lanes.increment[i]    = toPhase (signedRate);
+        lanes.rate[i]         = params.playbackRate;
+        lanes.envIncrement[i] = 1.0f / static_cast<float> (juce::jmax (1, params.lengthSamples));
+        lanes.envOffset[i]    = params.onsetDelay * lanes.envIncrement[i];
+        lanes.envTable[i]     = params.envTable;
+        lanes.envFamily[i]    = params.envFamily;
+        GrainEnvelope::getRampInverses (params.attackFrac, params.decayFrac, lanes.attackInv[i], lanes.decayInv[i]);
+        lanes.gainL[i]        = params.gain * std::cos (panAngle * juce::MathConstants<float>::halfPi);
+        lanes.gainR[i]        = params.gain * std::sin (panAngle * juce::MathConstants<float>::halfPi);
+        lanes.elapsed[i]      = 0;
+        lanes.length[i]       = params.lengthSamples;
+        lanes.fadeStart[i]    = kNoFade;
+
+        // Steal candidates, keyed for each policy
+        byOnset.insert (slot, params.onsetTime);
+        byEnd.insert (slot, params.onsetTime + params.lengthSamples);
+        byLookbackLow.insert (slot, params.lookback);
+        byLookbackHigh.insert (slot, -params.lookback);
+
+        activeIndex[i] = numActive;
+        activeSlots[static_cast<size_t> (numActive)] = slot;
+        ++numActive;
+        ++counters.spawns;
+        return slot;
+    }
+
+    /** Return a slot to the pool. The last live slot takes its place in the active list. */
+    void release (int slot)
+    {
+        const auto i = static_cast<size_t> (slot);
+        const int index = activeIndex[i];
+        if (index < 0)
+            return;
+
+        if (lanes.fadeStart[i] != kNoFade)
+            --numFading;
+        else
+            removeStealCandidate (slot);
+
+        --numActive;
+        const int moved = activeSlots[static_cast<size_t> (numActive)];
+        activeSlots[static_cast<size_t> (index)] = moved;
+        activeIndex[static_cast<size_t> (moved)] = index;
+        activeIndex[i] = -1;
+
+        nextFree[i] = freeHead;
+        freeHead = slot;
+    }
+
+    /** Make room in a full pool by fading out one grain over fadeSamples, chosen by
+        policy. targetLookback is the current Position, for StealPolicy::Furthest.
+        The grain keeps its slot until the fade ends; spawn() can use a reserve
+        slot meanwhile. Returns false if no grain could be stolen. */
+    bool steal (StealPolicy policy, float targetLookback, int fadeSamples)
+    {
+        int victim = -1;
+
+        switch (policy)
+        {
+            case StealPolicy::Oldest:   victim = byOnset.top(); break;
+            case StealPolicy::Quietest: victim = byEnd.top(); break;
+            case StealPolicy::Furthest:
             {
-                g.active = true;
-                g.currentSample = 0;
-                return &g;
+                // The furthest spawn position is one of the two extremes
+                const int low = byLookbackLow.top(), high = byLookbackHigh.top();
+                if (low >= 0)
+                    victim = std::abs (byLookbackLow.getKey (low) - targetLookback)
+                               >= std::abs (-byLookbackHigh.getKey (high) - targetLookback) ? low : high;
+                break;
             }
+            case StealPolicy::Off:
+            default:
+                break;
         }
-        return nullptr;
+
+        if (victim < 0 || freeHead < 0)
+            return false;
+
+        // Fade from where the grain has rendered to, and end with the fade
+        const auto i = static_cast<size_t> (victim);
+        const int fadeLength = juce::jmax (1, fadeSamples);
+        lanes.fadeStart[i] = lanes.elapsed[i];
+        lanes.fadeInv[i]   = 1.0f / static_cast<float> (fadeLength);
+        lanes.length[i]    = juce::jmin (lanes.length[i], lanes.elapsed[i] + fadeLength);
+
+        removeStealCandidate (victim);
+        ++numFading;
+        ++counters.steals;
+        return true;
+    }
+
+    bool isActive (int slot) const
+    {
+        return activeIndex[static_cast<size_t> (slot)] >= 0;
     }
 
-    /** Process all active grains and mix into output buffer.
-        Callback signature: void(Grain&, float& leftOut, float& rightOut)
-    */
+    /** Call func (int slot) for every active grain. func may release the slot it is given. */
     template <typename ProcessFunc>
     void processAll (ProcessFunc&& func)
     {
-        for (auto& g : grains)
+        // Walk backwards so a release swaps in a slot that has already been visited
+        for (int k = numActive - 1; k >= 0; --k)
+            func (activeSlots[static_cast<size_t> (k)]);
+    }
+
+    int getActiveCount() const { return numActive; }
+
+    /** Number of grains that may play at once (not counting fading stolen ones),
+        at most GranularConstants::kMaxGrains. */
+    int getCapacity() const { return capacity; }
+
+    /** Change the number of usable slots. Growing keeps every live grain; shrinking
+        stops the grains in slots beyond the new capacity. */
+    void setCapacity (int newCapacity)
+    {
+        capacity = juce::jlimit (1, GranularConstants::kMaxGrains, newCapacity);
+        const int numSlots = capacity + kStealReserve;
+
+        for (int k = numActive - 1; k >= 0; --k)
+            if (activeSlots[static_cast<size_t> (k)] >= numSlots)
+                release (activeSlots[static_cast<size_t> (k)]);
+
+        // Rebuild the free-list from the free slots in range, lowest first
+        freeHead = -1;
+        for (int i = numSlots - 1; i >= 0; --i)
         {
-            if (g.active)
-                func (g);
+            if (activeIndex[static_cast<size_t> (i)] < 0)
+            {
+                nextFree[static_cast<size_t> (i)] = freeHead;
+                freeHead = i;
+            }
         }
     }
 
-    int getActiveCount() const
+    /** Dense list of live slots, getActiveCount() entries long. */
+    const int* getActiveSlots() const { return activeSlots.data(); }
+
+    /** Spawn description of a slot (for the visualizer). */
+    const Grain& getGrain (int slot) const { return grains[static_cast<size_t> (slot)]; }
+
+    Lanes& getLanes() { return lanes; }
+    const Lanes& getLanes() const { return lanes; }
+
+    const Counters& getCounters() const { return counters; }
+
+    /** Get the normalised position within the grain [0, 1] */
+    float getNormalisedPosition (int slot) const
+    {
+        const auto i = static_cast<size_t> (slot);
+        return static_cast<float> (lanes.elapsed[i]) * lanes.envIncrement[i] + lanes.envOffset[i];
+    }
+
+    /** Get the current envelope amplitude */
+    float getEnvelopeAmplitude (int slot) const
     {
-        int count = 0;
-        for (const auto& g : grains)
-            if (g.active) ++count;
-        return count;
+        const auto i = static_cast<size_t> (slot);
+        return GrainEnvelope::getAmplitude (lanes.envTable[i], getNormalisedPosition (slot),
+                                            lanes.attackInv[i], lanes.decayInv[i]);
     }
 
-    /** Get read-only access to grains (for visualizer) */
-    const std::array<Grain, GranularConstants::kMaxGrains>& getGrains() const { return grains; }
+    /** Get the current read position in the circular buffer */
+    double getReadPosition (int slot) const
+    {
+        return fromPhase (lanes.phase[static_cast<size_t> (slot)]);
+    }
 
     void resetAll()
     {
-        for (auto& g : grains)
-            g.reset();
+        lanes.elapsed.fill (0);
+        lanes.length.fill (0);
+        lanes.fadeStart.fill (kNoFade);
+        activeIndex.fill (-1);
+        numActive = 0;
+        numFading = 0;
+        counters = {};
+
+        byOnset.clear();
+        byEnd.clear();
+        byLookbackLow.clear();
+        byLookbackHigh.clear();
+
+        const int numSlots = capacity + kStealReserve;
+        for (int i = 0; i < numSlots; ++i)
+            nextFree[static_cast<size_t> (i)] = i + 1 < numSlots ? i + 1 : -1;
+        freeHead = 0;
     }
 
 private:
-    std::array<Grain, GranularConstants::kMaxGrains> grains;
+    void removeStealCandidate (int slot)
+    {
+        byOnset.remove (slot);
+        byEnd.remove (slot);
+        byLookbackLow.remove (slot);
+        byLookbackHigh.remove (slot);
+    }
+
+    std::array<Grain, kMaxCapacity> grains;
+    Lanes lanes;
+
+    // Intrusive free-list: nextFree[slot] links free slots, -1 terminates
+    std::array<int, kMaxCapacity> nextFree {};
+    int freeHead = 0;
+
+    // Dense list of live slots, and each slot's index in it (-1 when free)
+    std::array<int, kMaxCapacity> activeSlots {};
+    std::array<int, kMaxCapacity> activeIndex {};
+    int numActive = 0;
+
+    int capacity = GranularConstants::kDefaultPoolCapacity;
+    int numFading = 0;   // stolen grains still fading out
+    Counters counters;
+
+    // Live, not yet stolen grains ordered for each steal policy
+    IndexedHeap<kMaxCapacity> byOnset, byEnd, byLookbackLow, byLookbackHigh;
 };
@@ -2,6 +2,8 @@
   ==============================================================================
     GrainScheduler.h
     Schedules grain creation based on density and scatter parameters.
+    Onsets are fractional sample times, resolved once per control sub-block
+    in a loop over grains, not samples.
   ==============================================================================
 */
 
@@ -9,8 +11,17 @@
 
 #include "GrainPool.h"
 #include "CircularBuffer.h"
+#include "RandomGenerator.h"
 #include <juce_core/juce_core.h>
 
+/** How inter-onset intervals are drawn around the mean 1 / density. */
+enum class SpawnMode
+{
+    Synchronous = 0,   // exactly periodic
+    QuasiSynchronous,  // periodic with uniform jitter
+    Poisson            // exponential intervals, no periodicity
+};
+
 class GrainScheduler
 {
 public:
@@ -19,76 +30,153 @@ public:
     void prepare (double sampleRate)
     {
         sr = sampleRate;
-        samplesUntilNextGrain = 0;
+        nextOnset = 0.0;
+        spanStart = 0.0;
     }
 
-    /** Call once per sample to potentially schedule a new grain.
-        All parameter values should be pre-modulated (after LFO etc). */
+    /** Modulated spawn settings, held constant over one control sub-block. */
+    struct Params
+    {
+        float grainSizeMs  = 100.0f;
+        float density      = 8.0f;     // grains per second
+        SpawnMode spawnMode = SpawnMode::Synchronous;
+        StealPolicy stealPolicy = StealPolicy::Off;
+        float position     = 50.0f;    // % of buffer back from the write head
+        float posScatter   = 0.0f;     // %
+        float pitch        = 0.0f;     // semitones
+        float pitchScatter = 0.0f;     // %
+        float pan          = 0.0f;     // -1..1
+        float panScatter   = 0.0f;     // %
+        ScatterDistribution scatterShape = ScatterDistribution::Uniform;
+        float attackFrac   = 25.0f;    // % of grain
+        float decayFrac    = 25.0f;    // % of grain
+        const float* envTable = nullptr;
+        GrainEnvelope::Family envFamily = GrainEnvelope::Family::Wavetable;
+        bool  reverse      = false;
+    };
+
+    /** Resolve the grain onsets due in the next numSamples samples.
+        Calls onSpawn (int slot, int offset) for every grain started. offset is
+        the first sample at or after the onset, relative to the start of the
+        span; the grain is advanced by the fraction of a sample it started early.
+        spanWritePos is the newest readable frame's end at the span's first
+        sample; each grain looks back from the head at its own onset. */
+    template <typename SpawnFunc>
     void process (GrainPool& pool, const CircularBuffer& circBuffer,
-                  float grainSizeMs, float density,
-                  float position, float posScatter,
-                  float pitch, float pitchScatter,
-                  float pan, float panScatter,
-                  float attackFrac, float decayFrac,
-                  EnvelopeShape envShape, bool reverse)
+                  const Params& params, int spanWritePos, int numSamples, SpawnFunc&& onSpawn)
     {
-        --samplesUntilNextGrain;
+        const auto lastSample = static_cast<double> (numSamples - 1);
 
-        if (samplesUntilNextGrain <= 0)
+        while (nextOnset <= lastSample)
         {
-            // Schedule next grain
-            const float intervalSamples = static_cast<float> (sr) / juce::jmax (0.1f, density);
-            samplesUntilNextGrain = static_cast<int> (intervalSamples);
-
-            // Try to acquire a grain
-            Grain* g = pool.acquire();
-            if (g == nullptr)
-                return; // Pool exhausted
-
-            // Grain duration
-            const float sizeSamples = (grainSizeMs / 1000.0f) * static_cast<float> (sr);
-            g->lengthSamples = juce::jmax (1, static_cast<int> (sizeSamples));
-
-            // Start position in circular buffer — RELATIVE to write head
-            // position=0% reads from recent data, position=100% reads oldest data
-            const float bufLen = static_cast<float> (circBuffer.getActiveLength());
-            const int writePos = circBuffer.getWritePosition();
-            const float lookbackAmount = (position / 100.0f) * bufLen;
-            const float scatterRange = (posScatter / 100.0f) * bufLen * 0.5f;
-            const float randomOffset = (random.nextFloat() * 2.0f - 1.0f) * scatterRange;
-            const float rawPos = static_cast<float> (writePos) - lookbackAmount + randomOffset;
-            g->startPos = std::fmod (rawPos + bufLen * 2.0f, bufLen);  // ensure positive
-
-            // Pitch (semitones → playback rate)
-            const float pitchRand = (random.nextFloat() * 2.0f - 1.0f) * (pitchScatter / 100.0f) * 12.0f;
-            const float totalPitch = pitch + pitchRand;
-            g->playbackRate = std::pow (2.0f, totalPitch / 12.0f);
-
-            // Pan
-            const float panRand = (random.nextFloat() * 2.0f - 1.0f) * (panScatter / 100.0f);
-            g->pan = juce::jlimit (-1.0f, 1.0f, pan + panRand);
-
-            // Envelope
-            g->attackFrac = attackFrac / 100.0f;
-            g->decayFrac  = decayFrac / 100.0f;
-            g->envShape   = envShape;
-
-            // Reverse
-            g->reversed = reverse;
-
-            // Reset playback
-            g->currentSample = 0;
-            g->gain = 1.0f;
+            const int offset = juce::jmax (0, static_cast<int> (std::ceil (nextOnset)));
+            const auto onsetDelay = static_cast<float> (static_cast<double> (offset) - nextOnset);
+
+            const int writePos = circBuffer.isFrozen() ? spanWritePos : spanWritePos + offset;
+            const int slot = spawnGrain (pool, circBuffer, params, writePos, spanStart + nextOnset, onsetDelay);
+            if (slot >= 0)
+                onSpawn (slot, offset);
+
+            nextOnset += nextInterval (params);
         }
+
+        // Keep the pending onset relative to the next span
+        nextOnset -= static_cast<double> (numSamples);
+        spanStart += static_cast<double> (numSamples);
     }
 
     void reset()
     {
-        samplesUntilNextGrain = 0;
+        nextOnset = 0.0;
+        spanStart = 0.0;
+    }
+
+    /** Restart the scatter sequence (see RandomGenerator::setSeed). */
+    void setSeed (juce::uint64 seed, juce::uint64 stream)
+    {
+        random.setSeed (seed, stream);
     }
 
 private:
+    /** Samples until the onset after this one. */
+    double nextInterval (const Params& params)
+    {
+        const double mean = sr / static_cast<double> (juce::jmax (0.1f, params.density));
+
+        switch (params.spawnMode)
+        {
+            case SpawnMode::QuasiSynchronous:
+                return mean * (1.0 + kQuasiSyncJitter * static_cast<double> (random.nextBipolar()));
+            case SpawnMode::Poisson:
+                return mean * static_cast<double> (random.nextExponential());
+            case SpawnMode::Synchronous:
+            default:
+                return mean;
+        }
+    }
+
+    /** Returns the pool slot spawned, or -1 if the pool is exhausted. */
+    int spawnGrain (GrainPool& pool, const CircularBuffer& circBuffer, const Params& params,
+                    int writePos, double onsetTime, float onsetDelay)
+    {
+        Grain grain;
+        grain.onsetTime  = onsetTime;
+        grain.onsetDelay = onsetDelay;
+
+        // Grain duration
+        const float sizeSamples = (params.grainSizeMs / 1000.0f) * static_cast<float> (sr);
+        grain.lengthSamples = juce::jmax (1, static_cast<int> (sizeSamples));
+
+        // Start position in circular buffer — RELATIVE to write head
+        // position=0% reads from recent data, position=100% reads oldest data
+        const float bufLen = static_cast<float> (circBuffer.getActiveLength());
+        const float lookbackAmount = (params.position / 100.0f) * bufLen;
+        // One batch of scatter values per grain: position, pitch, pan
+        float scatter[3];
+        random.fillScatter (params.scatterShape, scatter, 3);
+
+        const float scatterRange = (params.posScatter / 100.0f) * bufLen * 0.5f;
+        const float randomOffset = scatter[0] * scatterRange;
+        const double rawPos = static_cast<double> (writePos) - lookbackAmount + randomOffset;
+        grain.startPos = circBuffer.wrapPosition (rawPos);
+        grain.lookback = params.position - scatter[0] * params.posScatter * 0.5f;
+
+        // Pitch (semitones → playback rate)
+        const float pitchRand = scatter[1] * (params.pitchScatter / 100.0f) * 12.0f;
+        const float totalPitch = params.pitch + pitchRand;
+        grain.playbackRate = std::pow (2.0f, totalPitch / 12.0f);
+
+        // Pan
+        const float panRand = scatter[2] * (params.panScatter / 100.0f);
+        grain.pan = juce::jlimit (-1.0f, 1.0f, params.pan + panRand);
+
+        // Envelope
+        grain.attackFrac = params.attackFrac / 100.0f;
+        grain.decayFrac  = params.decayFrac / 100.0f;
+        grain.envTable   = params.envTable;
+        grain.envFamily  = params.envFamily;
+
+        // Reverse
+        grain.reversed = params.reverse;
+
+        grain.gain = 1.0f;
+
+        const int slot = pool.spawn (grain);
+        if (slot >= 0 || params.stealPolicy == StealPolicy::Off)
+            return slot;
+
+        // Full pool: fade a victim out and take a reserve slot
+        if (! pool.steal (params.stealPolicy, params.position, static_cast<int> (sr * kStealFadeSec)))
+            return -1;
+
+        return pool.spawn (grain);
+    }
+
     double sr = 44100.0;
-    int samplesUntilNextGrain = 0;
-    juce::Random random;
+    static constexpr double kQuasiSyncJitter = 0.25;   // +-25% of the mean interval
+    static constexpr double kStealFadeSec    = 0.003;  // fade of a stolen grain
+
+    double nextOnset = 0.0;   // samples from the start of the next span, > -1
+    double spanStart = 0.0;   // samples since reset at the start of the next span
+    RandomGenerator random;
 };
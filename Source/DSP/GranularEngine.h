@@ -9,33 +9,40 @@
 #pragma once
 
 #include "CircularBuffer.h"
+#include "CpuGovernor.h"
+#include "EngineParams.h"
+#include "EngineStats.h"
 #include "GrainPool.h"
 #include "GrainScheduler.h"
 #include "LFOModulator.h"
 #include "PostProcessor.h"
+#include "SimdKernels.h"
 #include "../Utils/Constants.h"
-#include "../Utils/ParamIDs.h"
-#include <juce_audio_processors/juce_audio_processors.h>
+#include "../Utils/RealtimeWorkerPool.h"
+#include "../Utils/TripleBuffer.h"
+#include <juce_dsp/juce_dsp.h>
 #include <juce_core/juce_core.h>
 #include <atomic>
 #include <array>
 #include <vector>
 #include <cmath>
 
-/** Snapshot of active grains for the visualizer (lock-free transfer). */
+/** Snapshot of active grains for the visualizer (lock-free transfer).
+    Only live grains are listed, so filling it costs nothing for idle slots. */
 struct GrainVisualData
 {
     struct GrainInfo
     {
-        bool  active        = false;
+        int   slot          = 0;      // pool slot, stable for the grain's lifetime
         float normPosition  = 0.0f;   // 0-1 in buffer
         float envelope      = 0.0f;   // current amplitude
         float pitch         = 0.0f;   // semitones
         float pan           = 0.0f;   // -1..1
         float size          = 0.0f;   // normalised grain size
     };
-    std::array<GrainInfo, GranularConstants::kMaxGrains> grains;
+    std::array<GrainInfo, GrainPool::kMaxCapacity> grains;   // first activeCount are valid
     int activeCount = 0;
+    int capacity = GranularConstants::kDefaultPoolCapacity;        // pool capacity when captured
     float inputLevel = 0.0f;
     float outputLevel = 0.0f;
 };
@@ -45,7 +52,10 @@ class GranularEngine
 public:
     GranularEngine() = default;
 
-    void prepare (double sampleRate, int samplesPerBlock, int numChannels)
+    /** poolCapacity is the number of grain slots to start with; process() follows
+        later changes of EngineParams::poolCapacity without allocating. */
+    void prepare (double sampleRate, int samplesPerBlock, int numChannels,
+                  int poolCapacity = GranularConstants::kDefaultPoolCapacity)
     {
         sr = sampleRate;
         blockSize = samplesPerBlock;
@@ -64,61 +74,161 @@ public:
         grainOutput.setSize (numChannels, samplesPerBlock);
         shimmerFeedback.setSize (numChannels, samplesPerBlock);
 
-        // Pre-allocate write position tracking
-        writePositions.resize (static_cast<size_t> (samplesPerBlock), 0);
+        // The worker threads wait for startWorkerThreads(), so a session that never
+        // enables multithreaded rendering never creates them
+        workerPool.stop();
 
+        // Pre-allocate per-block scratch, one set per possible rendering thread
+        grainCounts.resize (static_cast<size_t> (samplesPerBlock), 0.0f);
+
+        for (auto& scratch : threadScratch)
+            scratch.setSize (samplesPerBlock);
+
+        partitionData.assign (static_cast<size_t> ((kRenderPartitions - 1) * (numChannels + 1) * samplesPerBlock), 0.0f);
+
+        pool.setCapacity (poolCapacity);
         pool.resetAll();
         scheduler.reset();
         lfo.reset();
+        applyRandomSeed();
 
         smoothedDryWet.reset (sampleRate, 0.02);
         smoothedOutputLevel.reset (sampleRate, 0.02);
+
+        // Control-rate parameters ramp over a whole number of sub-blocks
+        const double rampSec = GranularConstants::kParamSmoothingSec;
+        smoothedGrainSize.reset (sampleRate, rampSec);
+        smoothedPosition.reset (sampleRate, rampSec);
+        smoothedPitch.reset (sampleRate, rampSec);
+        smoothedPan.reset (sampleRate, rampSec);
+        smoothedLowCut.reset (sampleRate, rampSec);
+        smoothedHighCut.reset (sampleRate, rampSec);
+        smoothedWidth.reset (sampleRate, rampSec);
+        controlParamsPrimed = false;
+
+        governor.prepare (sampleRate);
+        profiler.reset();
+    }
+
+    /** Start the worker threads for EngineParams::multithreaded, one per physical
+        core beyond the first. Call after prepare(), off the audio thread; it may
+        run while a block renders, as process() only picks the workers up once
+        they are all running. Parked workers cost no CPU, so they stay until the
+        next prepare(). */
+    void startWorkerThreads()
+    {
+        workerPool.start (juce::SystemStats::getNumPhysicalCpus() - 1, sr, blockSize);
+    }
+
+    /** Render one block. With EngineParams::adaptiveQuality set, the CPU governor
+        may render it with lower quality settings than requested. */
+    void process (juce::AudioBuffer<float>& buffer, const EngineParams& requestedParams)
+    {
+        profiler.beginBlock();
+
+        processBlock (buffer, governor.apply (requestedParams));
+
+        const double elapsed = profiler.endBlock (buffer.getNumSamples(), sr);
+        governor.update (elapsed, buffer.getNumSamples(), pool.getActiveCount(), requestedParams.adaptiveQuality);
+        publishStats();
+    }
+
+    /** Quality step the governor currently renders at, see CpuGovernor::Level. */
+    int getGovernorLevel() const { return governor.getLevel(); }
+
+    /** Latest performance counters (called from the message thread).
+        The reference stays valid until the next call. */
+    const EngineStats& getStats()
+    {
+        statsSnapshot.pull();
+        return statsSnapshot.getReadBuffer();
+    }
+
+    /** Send a user-drawn envelope curve to the audio thread (called from message thread).
+        Lock-free: the audio thread picks it up at the start of its next block. */
+    void setCustomEnvelope (const GrainEnvelope::CustomPoints& points)
+    {
+        customEnvelopeUpload.getWriteBuffer() = points;
+        customEnvelopeUpload.publish();
+    }
+
+    /** Get latest visual data for the UI (called from message thread).
+        The reference stays valid until the next call. */
+    const GrainVisualData& getVisualData()
+    {
+        visualData.pull();
+        return visualData.getReadBuffer();
     }
 
-    void process (juce::AudioBuffer<float>& buffer,
-                  juce::AudioProcessorValueTreeState& apvts)
+    void reset()
+    {
+        pool.resetAll();
+        scheduler.reset();
+        lfo.reset();
+        postProcessor.reset();
+        governor.reset();
+        profiler.reset();
+        applyRandomSeed();
+        controlParamsPrimed = false;
+    }
+
+    /** Seed for grain scatter and the S&H LFO. Takes effect at the next prepare()
+        or reset(), so a render started with the same seed repeats exactly. */
+    void setRandomSeed (juce::uint64 seed)
+    {
+        randomSeed.store (seed);
+    }
+
+    juce::uint64 getRandomSeed() const { return randomSeed.load(); }
+
+    /** Run the inner loops with a specific instruction set instead of the best one
+        this CPU supports (e.g. to compare them). Call before prepare(), not while
+        processing. Sets the CPU can't run fall back to the best one it can. */
+    void setInstructionSet (SimdKernels::InstructionSet isa)
+    {
+        kernels = &SimdKernels::get (isa);
+        postProcessor.setKernels (*kernels);
+    }
+
+    SimdKernels::InstructionSet getInstructionSet() const { return kernels->instructionSet; }
+
+private:
+    void processBlock (juce::AudioBuffer<float>& buffer, const EngineParams& params)
     {
         const int numSamples  = buffer.getNumSamples();
         const int numChannels = buffer.getNumChannels();
 
-        // Read parameter values
-        const float grainSizeMs = apvts.getRawParameterValue (ParamIDs::grainSize)->load();
-        const float density     = apvts.getRawParameterValue (ParamIDs::grainDensity)->load();
-        const float position    = apvts.getRawParameterValue (ParamIDs::grainPosition)->load();
-        const float pitch       = apvts.getRawParameterValue (ParamIDs::grainPitch)->load();
-        const float pan         = apvts.getRawParameterValue (ParamIDs::grainPan)->load();
-        const float posScatter  = apvts.getRawParameterValue (ParamIDs::posScatter)->load();
-        const float pitchScatter = apvts.getRawParameterValue (ParamIDs::pitchScatter)->load();
-        const float panScatter  = apvts.getRawParameterValue (ParamIDs::panScatter)->load();
-        const float attack      = apvts.getRawParameterValue (ParamIDs::grainAttack)->load();
-        const float decay       = apvts.getRawParameterValue (ParamIDs::grainDecay)->load();
-        const int   envShapeIdx = static_cast<int> (apvts.getRawParameterValue (ParamIDs::envelopeShape)->load());
-        const bool  freezeOn    = apvts.getRawParameterValue (ParamIDs::freeze)->load() > 0.5f;
-        const bool  reverseOn   = apvts.getRawParameterValue (ParamIDs::reverse)->load() > 0.5f;
-        const float feedbackAmt = apvts.getRawParameterValue (ParamIDs::feedback)->load();
-        const float shimmerAmt  = apvts.getRawParameterValue (ParamIDs::shimmer)->load();
-        const float lowCut      = apvts.getRawParameterValue (ParamIDs::lowCut)->load();
-        const float highCut     = apvts.getRawParameterValue (ParamIDs::highCut)->load();
-        const float lfoRate     = apvts.getRawParameterValue (ParamIDs::lfoRate)->load();
-        const float lfoDepth    = apvts.getRawParameterValue (ParamIDs::lfoDepth)->load();
-        const int   lfoShapeIdx = static_cast<int> (apvts.getRawParameterValue (ParamIDs::lfoShape)->load());
-        const int   lfoTargetIdx = static_cast<int> (apvts.getRawParameterValue (ParamIDs::lfoTarget)->load());
-        const float stereoWidth = apvts.getRawParameterValue (ParamIDs::stereoWidth)->load();
-        const float outLevel    = apvts.getRawParameterValue (ParamIDs::outputLevel)->load();
-        const float dryWet      = apvts.getRawParameterValue (ParamIDs::dryWet)->load();
-        const float bufLenSec   = apvts.getRawParameterValue (ParamIDs::bufferLength)->load();
-
-        const auto envShape  = static_cast<EnvelopeShape> (envShapeIdx);
-        const auto lfoShape  = static_cast<LFOShape> (lfoShapeIdx);
-        const auto lfoTarget = static_cast<LFOTarget> (lfoTargetIdx);
+        // Everything constant for the block is resolved into kernel choices here
+        blockKernels = &getKernelRow (params.interpolation, numChannels > 1);
+        readMargin = getReadMargin (params.interpolation);
+        const LfoApplier lfoApplier = getLfoApplier (params.lfoTarget);
+
+        // Pool storage is preallocated, so a capacity change is only a free-list rebuild
+        if (params.poolCapacity != pool.getCapacity())
+            pool.setCapacity (params.poolCapacity);
+
+        // Pick up a newly drawn custom envelope, if the UI has sent one. It goes
+        // into the spare Custom table, which may have to wait for the grains still
+        // reading it to finish (at most one grain length).
+        if (customEnvelopeUpload.pull())
+            customEnvelopePending = true;
+
+        if (customEnvelopePending && ! isEnvelopeTableInUse (envelopeTables.getSpareCustomTable()))
+        {
+            envelopeTables.setCustomPoints (customEnvelopeUpload.getReadBuffer());
+            customEnvelopePending = false;
+        }
+
+        const float* envTable = envelopeTables.getTable (params.envShape);
 
         // Update buffer length and freeze state
-        circularBuffer.setBufferLength (bufLenSec);
-        circularBuffer.setFrozen (freezeOn);
+        circularBuffer.setBufferLength (params.bufferLengthSec);
+        circularBuffer.setFrozen (params.freeze);
 
         // Set smoothed values
-        smoothedDryWet.setTargetValue (dryWet / 100.0f);
-        smoothedOutputLevel.setTargetValue (juce::Decibels::decibelsToGain (outLevel));
+        smoothedDryWet.setTargetValue (params.dryWet / 100.0f);
+        smoothedOutputLevel.setTargetValue (juce::Decibels::decibelsToGain (params.outputLevelDb));
+        setControlTargets (params);
 
         // Measure input level for visualizer
         float inLevelSum = 0.0f;
@@ -129,122 +239,116 @@ public:
         grainOutput.setSize (numChannels, numSamples, false, false, true);
         grainOutput.clear();
 
-        // Ensure write position tracking is large enough
-        if (static_cast<int> (writePositions.size()) < numSamples)
-            writePositions.resize (static_cast<size_t> (numSamples), 0);
-
-        // Process sample by sample
-        for (int s = 0; s < numSamples; ++s)
+        // Ensure per-block scratch is large enough
+        if (static_cast<int> (grainCounts.size()) < numSamples)
+            grainCounts.resize (static_cast<size_t> (numSamples), 0.0f);
+        if (threadScratch[0].size < numSamples)
+            threadScratch[0].setSize (numSamples);
+
+        std::fill (grainCounts.begin(), grainCounts.begin() + numSamples, 0.0f);
+        mainTarget = getRenderTarget (grainOutput.getWritePointer (0),
+                                      numChannels > 1 ? grainOutput.getWritePointer (1) : nullptr,
+                                      grainCounts.data(), 0);
+
+        // Write the whole input block to the circular buffer, remembering where it
+        // starts so the feedback can be mixed into the same frames later
+        blockWritePos = circularBuffer.getWritePosition();
+        circularBuffer.writeBlock (buffer.getArrayOfReadPointers(), numChannels, numSamples);
+        profiler.lap (EngineStats::BufferWrite);
+
+        // Grains carried over from the previous block render from the block start.
+        // Grains that finish here free their slot for this block's spawns.
+        if (shouldRenderInParallel (params, numSamples))
+        {
+            renderCarriedOverInParallel (numSamples, numChannels);
+        }
+        else
         {
-            // Record write position BEFORE writing (for feedback later)
-            writePositions[static_cast<size_t> (s)] = circularBuffer.getWritePosition();
+            pool.processAll ([&] (int slot)
+            {
+                renderGrain (slot, 0, numSamples);
+            });
+        }
 
-            // Write input to circular buffer
-            for (int ch = 0; ch < numChannels; ++ch)
-                circularBuffer.writeSample (ch, buffer.getSample (ch, s));
-            circularBuffer.advanceWritePosition();
+        profiler.lap (EngineStats::GrainRender);
+
+        // Resolve this block's spawn events, one control sub-block at a time
+        numSpawned = 0;
+
+        GrainScheduler::Params spawnParams;
+        spawnParams.density      = params.density * params.densityScale;
+        spawnParams.spawnMode    = params.spawnMode;
+        spawnParams.stealPolicy  = params.stealPolicy;
+        spawnParams.posScatter   = params.posScatter;
+        spawnParams.pitchScatter = params.pitchScatter;
+        spawnParams.panScatter   = params.panScatter;
+        spawnParams.scatterShape = params.scatterShape;
+        spawnParams.attackFrac   = params.attack;
+        spawnParams.decayFrac    = params.decay;
+        spawnParams.envTable     = envTable;
+        spawnParams.envFamily    = GrainEnvelope::getFamily (params.envShape);
+        spawnParams.reverse      = params.reverse;
+
+        for (int start = 0; start < numSamples; start += params.controlBlockSize)
+        {
+            const int n = juce::jmin (params.controlBlockSize, numSamples - start);
 
-            // LFO modulation
-            const float lfoValue = lfo.process (lfoRate, lfoShape) * (lfoDepth / 100.0f);
+            // LFO modulation, evaluated at the end of the sub-block
+            const float lfoValue = lfo.process (params.lfoRate, params.lfoShape, n) * (params.lfoDepth / 100.0f);
 
             // Apply LFO to target parameter
-            float modGrainSize = grainSizeMs;
-            float modPosition  = position;
-            float modPitch     = pitch;
-            float modPan       = pan;
+            ControlValues values { smoothedGrainSize.skip (n), smoothedPosition.skip (n),
+                                   smoothedPitch.skip (n), smoothedPan.skip (n) };
+            lfoApplier (values, lfoValue);
 
-            switch (lfoTarget)
-            {
-                case LFOTarget::Size:
-                    modGrainSize *= (1.0f + lfoValue * 0.5f);
-                    break;
-                case LFOTarget::Position:
-                    modPosition += lfoValue * 30.0f;
-                    break;
-                case LFOTarget::Pitch:
-                    modPitch += lfoValue * 12.0f;
-                    break;
-                case LFOTarget::Pan:
-                    modPan = juce::jlimit (-1.0f, 1.0f, modPan + lfoValue);
-                    break;
-                case LFOTarget::Filter:
-                    // Filter modulation is handled later in post-processing
-                    break;
-            }
-
-            modGrainSize = juce::jlimit (GranularConstants::kMinGrainSizeMs,
-                                          GranularConstants::kMaxGrainSizeMs, modGrainSize);
-            modPosition = juce::jlimit (0.0f, 100.0f, modPosition);
+            spawnParams.grainSizeMs = juce::jlimit (GranularConstants::kMinGrainSizeMs,
+                                                    GranularConstants::kMaxGrainSizeMs, values.grainSize);
+            spawnParams.position    = juce::jlimit (0.0f, 100.0f, values.position);
+            spawnParams.pitch       = values.pitch;
+            spawnParams.pan         = values.pan;
 
             // Schedule new grains
-            scheduler.process (pool, circularBuffer,
-                              modGrainSize, density,
-                              modPosition, posScatter,
-                              modPitch, pitchScatter,
-                              modPan, panScatter,
-                              attack, decay,
-                              envShape, reverseOn);
-
-            // Process all active grains and sum their output
-            float mixL = 0.0f, mixR = 0.0f;
-            int activeGrainCount = 0;
-
-            pool.processAll ([&] (Grain& grain)
+            scheduler.process (pool, circularBuffer, spawnParams, getWriteHeadAt (start), n, [&] (int slot, int offset)
             {
-                const float readPos = grain.getReadPosition();
-                const float envAmp  = grain.getEnvelopeAmplitude();
-
-                // Read from circular buffer
-                float sampleL = circularBuffer.readSample (0, readPos);
-                float sampleR = numChannels > 1 ? circularBuffer.readSample (1, readPos) : sampleL;
+                spawned[static_cast<size_t> (numSpawned)] = { slot, start + offset };
+                ++numSpawned;
+            });
+        }
 
-                // Apply envelope and gain
-                sampleL *= envAmp * grain.gain;
-                sampleR *= envAmp * grain.gain;
+        profiler.lap (EngineStats::Scheduling);
 
-                // Apply panning (constant power)
-                const float panAngle = (grain.pan + 1.0f) * 0.5f; // 0-1
-                const float panL = std::cos (panAngle * juce::MathConstants<float>::halfPi);
-                const float panR = std::sin (panAngle * juce::MathConstants<float>::halfPi);
+        // Render each new grain from its onset to the end of the block
+        for (int i = 0; i < numSpawned; ++i)
+        {
+            const auto& spawn = spawned[static_cast<size_t> (i)];
+            renderGrain (spawn.slot, spawn.offset, numSamples);
+        }
 
-                mixL += sampleL * panL;
-                mixR += sampleR * panR;
+        // Normalize by active grain count to prevent volume explosion
+        // Use sqrt scaling for more natural summing behavior
+        for (int ch = 0; ch < numChannels; ++ch)
+            kernels->normalise (grainOutput.getWritePointer (ch), grainCounts.data(), numSamples);
 
-                ++activeGrainCount;
-                grain.advance();
-            });
+        profiler.lap (EngineStats::GrainRender);
 
-            // Normalize by active grain count to prevent volume explosion
-            // Use sqrt scaling for more natural summing behavior
-            if (activeGrainCount > 1)
-            {
-                const float normFactor = 1.0f / std::sqrt (static_cast<float> (activeGrainCount));
-                mixL *= normFactor;
-                mixR *= normFactor;
-            }
+        // Post-processing (filters, DC blocker, width, shimmer, soft clip) per control sub-block
+        for (int start = 0; start < numSamples; start += params.controlBlockSize)
+        {
+            const int n = juce::jmin (params.controlBlockSize, numSamples - start);
 
-            // Write grain mix to output
-            grainOutput.setSample (0, s, mixL);
-            if (numChannels > 1)
-                grainOutput.setSample (1, s, mixR);
+            postProcessor.process (grainOutput, start, n,
+                                   smoothedLowCut.skip (n), smoothedHighCut.skip (n), smoothedWidth.skip (n),
+                                   params.shimmer, shimmerFeedback);
         }
 
-        // Post-processing (filters, DC blocker, width, shimmer, soft clip)
-        postProcessor.process (grainOutput, lowCut, highCut, stereoWidth, shimmerAmt, shimmerFeedback);
+        profiler.lap (EngineStats::PostProcess);
 
-        // Write feedback back into circular buffer at the CORRECT per-sample positions
-        if (feedbackAmt > 0.001f)
-        {
-            for (int s = 0; s < numSamples; ++s)
-            {
-                const int fbPos = writePositions[static_cast<size_t> (s)];
-                for (int ch = 0; ch < numChannels; ++ch)
-                {
-                    const float fbSample = grainOutput.getSample (ch, s) * feedbackAmt;
-                    circularBuffer.writeFeedbackAt (ch, fbPos, fbSample);
-                }
-            }
-        }
+        // Mix feedback back into the frames this block's input was written to
+        if (params.feedback > 0.001f)
+            circularBuffer.addBlock (blockWritePos, grainOutput.getArrayOfReadPointers(),
+                                     numChannels, numSamples, params.feedback);
+
+        profiler.lap (EngineStats::Feedback);
 
         // Measure output level for visualizer
         float outLevelSum = 0.0f;
@@ -269,54 +373,459 @@ public:
         // Update visual data (lock-free)
         updateVisualData (inLevelSum / static_cast<float> (numChannels),
                           outLevelSum / static_cast<float> (numChannels));
+
+        profiler.lap (EngineStats::Mix);
     }
 
-    /** Get latest visual data for the UI (called from message thread). */
-    GrainVisualData getVisualData() const
+    /** Restart every random stream from the instance seed, one stream each. */
+    void applyRandomSeed()
     {
-        return visualData.load();
+        const auto seed = randomSeed.load();
+        scheduler.setSeed (seed, 0);
+        lfo.setSeed (seed, 1);
     }
 
-    void reset()
+    /** Point the control-rate smoothers at this block's values. The first block
+        after prepare or reset starts on them instead of ramping from defaults. */
+    void setControlTargets (const EngineParams& params)
     {
-        pool.resetAll();
-        scheduler.reset();
-        lfo.reset();
-        postProcessor.reset();
+        if (! controlParamsPrimed)
+        {
+            smoothedGrainSize.setCurrentAndTargetValue (params.grainSizeMs);
+            smoothedPosition.setCurrentAndTargetValue (params.position);
+            smoothedPitch.setCurrentAndTargetValue (params.pitch);
+            smoothedPan.setCurrentAndTargetValue (params.pan);
+            smoothedLowCut.setCurrentAndTargetValue (params.lowCut);
+            smoothedHighCut.setCurrentAndTargetValue (params.highCut);
+            smoothedWidth.setCurrentAndTargetValue (params.stereoWidth);
+            controlParamsPrimed = true;
+            return;
+        }
+
+        smoothedGrainSize.setTargetValue (params.grainSizeMs);
+        smoothedPosition.setTargetValue (params.position);
+        smoothedPitch.setTargetValue (params.pitch);
+        smoothedPan.setTargetValue (params.pan);
+        smoothedLowCut.setTargetValue (params.lowCut);
+        smoothedHighCut.setTargetValue (params.highCut);
+        smoothedWidth.setTargetValue (params.stereoWidth);
+    }
+
+    /** Where one thread renders grains: output channels and grain counts from
+        block sample 0, and that thread's envelope and source scratch. */
+    struct RenderTarget
+    {
+        float* outL = nullptr;
+        float* outR = nullptr;     // null for mono
+        float* counts = nullptr;
+        float* envelope = nullptr;
+        float* sourceL = nullptr;
+        float* sourceR = nullptr;
+    };
+
+    struct ThreadScratch
+    {
+        void setSize (int numSamples)
+        {
+            size = numSamples;
+            envelope.resize (static_cast<size_t> (numSamples), 0.0f);
+            sourceL.resize (static_cast<size_t> (numSamples), 0.0f);
+            sourceR.resize (static_cast<size_t> (numSamples), 0.0f);
+        }
+
+        std::vector<float> envelope, sourceL, sourceR;
+        int size = 0;
+    };
+
+    /** Spawn-time control values after smoothing, before the LFO is applied. */
+    struct ControlValues
+    {
+        float grainSize, position, pitch, pan;
+    };
+
+    using LfoApplier = void (*) (ControlValues&, float lfoValue);
+
+    template <LFOTarget target>
+    static void applyLfo (ControlValues& values, float lfoValue)
+    {
+        if constexpr (target == LFOTarget::Size)
+            values.grainSize *= (1.0f + lfoValue * 0.5f);
+        else if constexpr (target == LFOTarget::Position)
+            values.position += lfoValue * 30.0f;
+        else if constexpr (target == LFOTarget::Pitch)
+            values.pitch += lfoValue * 12.0f;
+        else if constexpr (target == LFOTarget::Pan)
+            values.pan = juce::jlimit (-1.0f, 1.0f, values.pan + lfoValue);
+        else
+            juce::ignoreUnused (values, lfoValue);   // Filter modulation is handled later in post-processing
+    }
+
+    static LfoApplier getLfoApplier (LFOTarget target)
+    {
+        static constexpr std::array<LfoApplier, 5> appliers {
+            &applyLfo<LFOTarget::Size>, &applyLfo<LFOTarget::Position>, &applyLfo<LFOTarget::Pitch>,
+            &applyLfo<LFOTarget::Pan>,  &applyLfo<LFOTarget::Filter>
+        };
+
+        return appliers[static_cast<size_t> (juce::jlimit (0, 4, static_cast<int> (target)))];
+    }
+
+    /** A grain render kernel with every block- and grain-constant choice compiled in. */
+    using GrainKernel = void (GranularEngine::*) (int slot, int startSample, int numSamples, const RenderTarget& target);
+
+    /** Kernels for one interpolation quality and channel layout, indexed
+        [envelope family][steal fade]. */
+    using KernelRow = std::array<std::array<GrainKernel, 2>, GrainEnvelope::kNumFamilies>;
+
+    template <InterpolationQuality quality, bool stereo>
+    static constexpr KernelRow makeKernelRow()
+    {
+        using Family = GrainEnvelope::Family;
+
+        return {{ { &GranularEngine::renderGrain<quality, stereo, Family::Wavetable, false>,
+                    &GranularEngine::renderGrain<quality, stereo, Family::Wavetable, true> },
+                  { &GranularEngine::renderGrain<quality, stereo, Family::Ramp, false>,
+                    &GranularEngine::renderGrain<quality, stereo, Family::Ramp, true> } }};
+    }
+
+    /** Kernel row for a block, chosen once before any grain is rendered. */
+    static const KernelRow& getKernelRow (InterpolationQuality quality, bool stereo)
+    {
+        static constexpr std::array<std::array<KernelRow, 2>, 4> rows {{
+            { makeKernelRow<InterpolationQuality::Linear,  false>(), makeKernelRow<InterpolationQuality::Linear,  true>() },
+            { makeKernelRow<InterpolationQuality::Hermite, false>(), makeKernelRow<InterpolationQuality::Hermite, true>() },
+            { makeKernelRow<InterpolationQuality::Sinc,    false>(), makeKernelRow<InterpolationQuality::Sinc,    true>() },
+            { makeKernelRow<InterpolationQuality::Octaves, false>(), makeKernelRow<InterpolationQuality::Octaves, true>() }
+        }};
+
+        const int index = juce::jlimit (0, 3, static_cast<int> (quality));
+        return rows[static_cast<size_t> (index)][stereo ? 1 : 0];
+    }
+
+    /** Render one grain from block offset startSample until it ends or the block does,
+        into the block's output, and release it if it ended. */
+    void renderGrain (int slot, int startSample, int numSamples)
+    {
+        renderGrain (slot, startSample, numSamples, mainTarget);
+
+        if (hasFinished (slot))
+            pool.release (slot);
+    }
+
+    /** Render one grain into target with the kernel for its envelope family and
+        steal state. Touches only the grain's own lanes, so any thread may call it. */
+    void renderGrain (int slot, int startSample, int numSamples, const RenderTarget& target)
+    {
+        const auto& lanes = pool.getLanes();
+        const auto i0 = static_cast<size_t> (slot);
+        const auto family = static_cast<size_t> (lanes.envFamily[i0]);
+        const size_t fading = lanes.fadeStart[i0] != GrainPool::kNoFade ? 1 : 0;
+
+        (this->*(*blockKernels)[family][fading]) (slot, startSample, numSamples, target);
+    }
+
+    bool hasFinished (int slot) const
+    {
+        const auto& lanes = pool.getLanes();
+        return lanes.elapsed[static_cast<size_t> (slot)] >= lanes.length[static_cast<size_t> (slot)];
+    }
+
+    /** Envelope, read positions and pan gains are all resolved before the mixing loop.
+        Reversed grains need no variant: their phase increment is negative. */
+    template <InterpolationQuality quality, bool stereo, GrainEnvelope::Family family, bool fading>
+    void renderGrain (int slot, int startSample, int numSamples, const RenderTarget& target)
+    {
+        auto& lanes = pool.getLanes();
+        const auto i0 = static_cast<size_t> (slot);
+        const int elapsed = lanes.elapsed[i0];
+        const int span = juce::jmin (numSamples - startSample, lanes.length[i0] - elapsed);
+
+        if (span > 0)
+        {
+            const float envIncrement = lanes.envIncrement[i0];
+            float* env = target.envelope;
+
+            const float envStart = static_cast<float> (elapsed) * envIncrement + lanes.envOffset[i0];
+
+            if constexpr (family == GrainEnvelope::Family::Ramp)
+                kernels->fillRamp (env, span, envStart, envIncrement, lanes.attackInv[i0], lanes.decayInv[i0]);
+            else
+                kernels->fillEnvelope (env, span, envStart, envIncrement, lanes.attackInv[i0], lanes.decayInv[i0], lanes.envTable[i0]);
+
+            // A stolen grain ramps to silence over its remaining samples
+            if constexpr (fading)
+            {
+                const float fadeInv = lanes.fadeInv[i0];
+                const int fadeStart = lanes.fadeStart[i0];
+
+                for (int i = 0; i < span; ++i)
+                    env[i] *= juce::jmax (0.0f, 1.0f - static_cast<float> (elapsed + i - fadeStart + 1) * fadeInv);
+            }
+
+            const float rate = lanes.rate[i0];
+            const SincTable::Bank sincBank = quality == InterpolationQuality::Sinc ? sincTable.getBank (rate) : SincTable::Bank {};
+
+            // Pitched-up grains read the pre-filtered octave level at a proportionally lower rate
+            const int octave = quality == InterpolationQuality::Octaves ? CircularBuffer::getOctaveForRate (rate) : 0;
+            const GrainPool::Phase increment = lanes.increment[i0];
+            GrainPool::Phase phase = lanes.phase[i0];
+
+            float* count = target.counts + startSample;
+            float* outL = target.outL + startSample;
+            float* left = target.sourceL;
+            float* right = target.sourceR;
+
+            // Source samples first, in runs that stay inside the Buffer Length window
+            for (int done = 0; done < span;)
+            {
+                const int run = wrapIntoWindow (phase, increment, startSample + done, span - done);
+                readSource<quality, stereo> (phase, increment, octave, sincBank, run, left + done, right + done);
+
+                phase += static_cast<GrainPool::Phase> (run) * increment;
+                done += run;
+            }
+
+            // Then one mixing pass
+            if constexpr (stereo)
+                kernels->mixStereo (outL, target.outR + startSample, count, left, right,
+                                   env, lanes.gainL[i0], lanes.gainR[i0], span);
+            else
+                kernels->mixMono (outL, count, left, env, lanes.gainL[i0], span);
+
+            lanes.phase[i0] = phase;
+            lanes.elapsed[i0] = elapsed + span;
+        }
+    }
+
+    /** Interpolated source samples for numSamples reads from a level-0 phase. */
+    template <InterpolationQuality quality, bool stereo>
+    void readSource (GrainPool::Phase phase, GrainPool::Phase increment, int octave, const SincTable::Bank& sincBank,
+                     int numSamples, float* left, float* right) const
+    {
+        if constexpr (quality == InterpolationQuality::Hermite || quality == InterpolationQuality::Octaves)
+        {
+            const auto ring = circularBuffer.getRing (octave);
+
+            if constexpr (stereo)
+                kernels->readHermiteStereo (ring, phase >> octave, increment >> octave, numSamples, left, right);
+            else
+                kernels->readHermiteMono (ring, phase >> octave, increment >> octave, numSamples, left);
+        }
+        else
+        {
+            juce::ignoreUnused (octave);
+
+            for (int i = 0; i < numSamples; ++i, phase += increment)
+            {
+                const int whole = GrainPool::phaseIndex (phase);
+                const float frac = GrainPool::phaseFraction (phase);
+
+                if constexpr (stereo && quality == InterpolationQuality::Linear)
+                    circularBuffer.readStereoLinear (whole, frac, left[i], right[i]);
+                else if constexpr (stereo)
+                    circularBuffer.readStereoSinc (whole, frac, sincBank, left[i], right[i]);
+                else if constexpr (quality == InterpolationQuality::Linear)
+                    left[i] = circularBuffer.readSampleLinear (0, whole, frac);
+                else
+                    left[i] = circularBuffer.readSampleSinc (0, whole, frac, sincBank);
+            }
+        }
+    }
+
+    /** True while any live grain is still bound to this envelope table. */
+    bool isEnvelopeTableInUse (const float* table) const
+    {
+        const auto& lanes = pool.getLanes();
+        const int* slots = pool.getActiveSlots();
+
+        for (int k = 0; k < pool.getActiveCount(); ++k)
+            if (lanes.envTable[static_cast<size_t> (slots[k])] == table)
+                return true;
+
+        return false;
+    }
+
+    /** Frames an interpolator reads past its read position, rounded up: the
+        Octaves filters reach 35 level-0 frames ahead, and Hermite on level 3 16. */
+    static constexpr int getReadMargin (InterpolationQuality quality)
+    {
+        switch (quality)
+        {
+            case InterpolationQuality::Linear:  return 1;
+            case InterpolationQuality::Sinc:    return SincTable::kMaxTaps / 2;
+            case InterpolationQuality::Octaves: return 64;
+            case InterpolationQuality::Hermite:
+            default:                            return 2;
+        }
+    }
+
+    /** Where the ring ends as seen by a grain at block sample sample: the write
+        head just after that sample's input frame went in (or the frozen head),
+        less the interpolator's reach, so no read touches input that arrives
+        later. Grains use it rather than the end-of-block head, so the output
+        does not depend on the host's block size. */
+    int getWriteHeadAt (int sample) const
+    {
+        const int head = circularBuffer.isFrozen() ? circularBuffer.getWritePosition()
+                                                   : blockWritePos + sample + 1;
+
+        return (head - readMargin) & (circularBuffer.getCapacity() - 1);
+    }
+
+    /** Keep a grain read at block sample sample inside the active window, the
+        Buffer Length frames up to the write head at that sample, as if the ring
+        were Buffer Length long: a phase outside it moves by whole window lengths to
+        the same place in the window. Returns how many of the next maxSamples reads
+        stay inside before the grain, or the moving head, reaches an edge. */
+    int wrapIntoWindow (GrainPool::Phase& phase, GrainPool::Phase increment, int sample, int maxSamples) const
+    {
+        const GrainPool::Phase window = GrainPool::toPhase (circularBuffer.getActiveLength());
+        const GrainPool::Phase ringMask = GrainPool::toPhase (circularBuffer.getCapacity()) - 1;
+
+        // Distance up to the write head in (0, window]: 0 is the newest frame's end
+        const GrainPool::Phase ahead = (GrainPool::toPhase (getWriteHeadAt (sample)) - phase) & ringMask;
+        const GrainPool::Phase wrapped = ahead > 0 && ahead <= window ? ahead : (ahead + window - 1) % window + 1;
+        phase += ahead - wrapped;
+
+        // How fast the grain closes on the head, which moves one frame per sample
+        const GrainPool::Phase closing = increment - (circularBuffer.isFrozen() ? 0 : GrainPool::toPhase (1));
+        juce::int64 reads = maxSamples;
+
+        if (closing > 0)
+            reads = (wrapped + closing - 1) / closing;
+        else if (closing < 0)
+            reads = (window - wrapped) / -closing + 1;
+
+        return static_cast<int> (juce::jlimit (juce::int64 (1), juce::int64 (maxSamples), reads));
+    }
+
+    //==============================================================================
+    bool shouldRenderInParallel (const EngineParams& params, int numSamples) const
+    {
+        return params.multithreaded
+            && workerPool.getNumWorkers() > 0
+            && numSamples <= blockSize
+            && pool.getActiveCount() * numSamples >= GranularConstants::kParallelRenderThreshold;
+    }
+
+    /** Render the grains carried over from the previous block on the worker pool.
+        The active list is cut into kRenderPartitions fixed ranges, each summed into
+        its own buffer, and the buffers are added up in partition order, so the
+        output does not depend on which thread rendered which range. */
+    void renderCarriedOverInParallel (int numSamples, int numChannels)
+    {
+        parallelGrains = pool.getActiveCount();
+        parallelSamples = numSamples;
+        parallelChannels = numChannels;
+        std::copy_n (pool.getActiveSlots(), parallelGrains, parallelSlots.begin());
+
+        partitionSize = (parallelGrains + kRenderPartitions - 1) / kRenderPartitions;
+        const int numPartitions = (parallelGrains + partitionSize - 1) / partitionSize;
+
+        workerPool.run (&GranularEngine::renderPartitionTask, this, numPartitions);
+
+        for (int p = 1; p < numPartitions; ++p)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                juce::FloatVectorOperations::add (grainOutput.getWritePointer (ch), getPartitionChannel (p, ch), numSamples);
+
+            juce::FloatVectorOperations::add (grainCounts.data(), getPartitionChannel (p, numChannels), numSamples);
+        }
+
+        // Workers never change the pool's lists, so finished grains are released here
+        for (int k = 0; k < parallelGrains; ++k)
+            if (hasFinished (parallelSlots[static_cast<size_t> (k)]))
+                pool.release (parallelSlots[static_cast<size_t> (k)]);
+    }
+
+    static void renderPartitionTask (void* context, int partition, int worker)
+    {
+        static_cast<GranularEngine*> (context)->renderPartition (partition, worker);
+    }
+
+    /** Partition 0 renders straight into the block output, the others into their
+        own buffers. */
+    void renderPartition (int partition, int worker)
+    {
+        RenderTarget target;
+
+        if (partition == 0)
+        {
+            target = getRenderTarget (mainTarget.outL, mainTarget.outR, mainTarget.counts, worker);
+        }
+        else
+        {
+            for (int ch = 0; ch <= parallelChannels; ++ch)
+                juce::FloatVectorOperations::clear (getPartitionChannel (partition, ch), parallelSamples);
+
+            target = getRenderTarget (getPartitionChannel (partition, 0),
+                                      parallelChannels > 1 ? getPartitionChannel (partition, 1) : nullptr,
+                                      getPartitionChannel (partition, parallelChannels), worker);
+        }
+
+        const int first = partition * partitionSize;
+        const int last = juce::jmin (parallelGrains, first + partitionSize);
+
+        for (int k = first; k < last; ++k)
+            renderGrain (parallelSlots[static_cast<size_t> (k)], 0, parallelSamples, target);
+    }
+
+    /** Channel ch of a partition's buffer; channel numChannels holds its grain counts. */
+    float* getPartitionChannel (int partition, int ch)
+    {
+        const int stride = (parallelChannels + 1) * blockSize;
+        return partitionData.data() + (partition - 1) * stride + ch * blockSize;
+    }
+
+    RenderTarget getRenderTarget (float* outL, float* outR, float* counts, int worker)
+    {
+        auto& scratch = threadScratch[static_cast<size_t> (worker)];
+        return { outL, outR, counts, scratch.envelope.data(), scratch.sourceL.data(), scratch.sourceR.data() };
+    }
+
+    void publishStats()
+    {
+        auto& stats = profiler.getStats();
+        const auto& counters = pool.getCounters();
+        stats.spawns = counters.spawns;
+        stats.steals = counters.steals;
+        stats.exhausted = counters.exhausted;
+        stats.activeGrains = pool.getActiveCount();
+        stats.peakActiveGrains = juce::jmax (stats.peakActiveGrains, stats.activeGrains);
+        stats.poolCapacity = pool.getCapacity();
+        stats.governorLevel = governor.getLevel();
+
+        statsSnapshot.getWriteBuffer() = stats;
+        statsSnapshot.publish();
     }
 
-private:
     void updateVisualData (float inLevel, float outLevel)
     {
-        GrainVisualData data;
+        auto& data = visualData.getWriteBuffer();
         data.inputLevel = inLevel;
         data.outputLevel = outLevel;
-        data.activeCount = 0;
+        data.capacity = pool.getCapacity();
+        data.activeCount = pool.getActiveCount();
 
-        const auto& grains = pool.getGrains();
         const float bufLen = static_cast<float> (circularBuffer.getActiveLength());
         const float maxSize = GranularConstants::kMaxGrainSizeMs / 1000.0f * static_cast<float> (sr);
+        const int* slots = pool.getActiveSlots();
 
-        for (int i = 0; i < GranularConstants::kMaxGrains; ++i)
+        for (int k = 0; k < data.activeCount; ++k)
         {
-            const auto& g = grains[static_cast<size_t> (i)];
-            data.grains[static_cast<size_t> (i)].active = g.active;
-
-            if (g.active)
-            {
-                data.grains[static_cast<size_t> (i)].normPosition = 
-                    bufLen > 0.0f ? std::fmod (g.getReadPosition(), bufLen) / bufLen : 0.0f;
-                data.grains[static_cast<size_t> (i)].envelope = g.getEnvelopeAmplitude();
-                data.grains[static_cast<size_t> (i)].pitch = 
-                    12.0f * std::log2 (std::max (0.001f, g.playbackRate));
-                data.grains[static_cast<size_t> (i)].pan = g.pan;
-                data.grains[static_cast<size_t> (i)].size = 
-                    maxSize > 0.0f ? static_cast<float> (g.lengthSamples) / maxSize : 0.0f;
-                ++data.activeCount;
-            }
+            const int i = slots[k];
+            const auto& g = pool.getGrain (i);
+            auto& info = data.grains[static_cast<size_t> (k)];
+
+            info.slot = i;
+            info.normPosition = bufLen > 0.0f ? static_cast<float> (circularBuffer.getWindowPosition (pool.getReadPosition (i))) / bufLen : 0.0f;
+            info.envelope = pool.getEnvelopeAmplitude (i);
+            info.pitch = 12.0f * std::log2 (std::max (0.001f, g.playbackRate));
+            info.pan = g.pan;
+            info.size = maxSize > 0.0f ? static_cast<float> (g.lengthSamples) / maxSize : 0.0f;
         }
 
-        visualData.store (data);
+        visualData.publish();
     }
 
     double sr = 44100.0;
@@ -328,15 +837,60 @@ private:
     GrainScheduler    scheduler;
     LFOModulator      lfo;
     PostProcessor     postProcessor;
+    CpuGovernor       governor;
+    EngineProfiler    profiler;
+
+    GrainEnvelope::TableBank envelopeTables;
+    SincTable sincTable;
+    const KernelRow* blockKernels = &getKernelRow (InterpolationQuality::Hermite, true);
+    const SimdKernels::Kernels* kernels = &SimdKernels::get();   // best for this CPU unless overridden
+    TripleBuffer<GrainEnvelope::CustomPoints> customEnvelopeUpload;
+    bool customEnvelopePending = false;     // pulled upload waiting for a free Custom table
+    std::atomic<juce::uint64> randomSeed { 0 };
 
     juce::AudioBuffer<float> grainOutput;
     juce::AudioBuffer<float> shimmerFeedback;
 
-    // Track write positions per sample for correct feedback
-    std::vector<int> writePositions;
+    // Grain-major rendering scratch: active grains per output sample, and per
+    // rendering thread one grain's envelope and source samples
+    std::vector<float> grainCounts;
+    std::array<ThreadScratch, RealtimeWorkerPool::kMaxWorkers + 1> threadScratch;
+    RenderTarget mainTarget;
+    int blockWritePos = 0;   // write head before this block's input went in
+    int readMargin = 0;      // getReadMargin() of this block's quality
+
+    // Multithreaded rendering of carried-over grains
+    static constexpr int kRenderPartitions = 16;
+    RealtimeWorkerPool workerPool;
+    std::vector<float> partitionData;   // partitions 1.., each (channels + counts) x blockSize
+    std::array<int, GrainPool::kMaxCapacity> parallelSlots {};
+    int parallelGrains = 0;
+    int parallelSamples = 0;
+    int parallelChannels = 0;
+    int partitionSize = 1;
+
+    // Grains spawned during the current block and their onset within it
+    struct SpawnEvent
+    {
+        int slot   = -1;
+        int offset = 0;
+    };
+    std::array<SpawnEvent, GrainPool::kMaxCapacity> spawned;
+    int numSpawned = 0;
 
     juce::SmoothedValue<float> smoothedDryWet  { 0.5f };
     juce::SmoothedValue<float> smoothedOutputLevel { 1.0f };
 
-    std::atomic<GrainVisualData> visualData;
+    // Control-rate parameters, advanced once per sub-block
+    juce::SmoothedValue<float> smoothedGrainSize { GranularConstants::kDefaultGrainSize };
+    juce::SmoothedValue<float> smoothedPosition  { 50.0f };
+    juce::SmoothedValue<float> smoothedPitch     { 0.0f };
+    juce::SmoothedValue<float> smoothedPan       { 0.0f };
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> smoothedLowCut  { 20.0f };
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> smoothedHighCut { 20000.0f };
+    juce::SmoothedValue<float> smoothedWidth     { 100.0f };
+    bool controlParamsPrimed = false;
+
+    TripleBuffer<GrainVisualData> visualData;
+    TripleBuffer<EngineStats> statsSnapshot;
 };
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+    IndexedHeap.h
+    Fixed-capacity binary min-heap of integer ids (e.g. pool slots) with a
+    key per id. Each id remembers its heap position, so removing an arbitrary
+    id is O(log n) like insertion. Never allocates.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+
+template <size_t Capacity>
+class IndexedHeap
+{
+public:
+    IndexedHeap()
+    {
+        position.fill (-1);
+    }
+
+    bool isEmpty() const           { return size == 0; }
+    bool contains (int id) const   { return position[static_cast<size_t> (id)] >= 0; }
+
+    /** Id with the smallest key, or -1 if the heap is empty. */
+    int top() const                { return size > 0 ? heap[0] : -1; }
+
+    double getKey (int id) const   { return keys[static_cast<size_t> (id)]; }
+
+    /** Add an id that is not in the heap yet. */
+    void insert (int id, double key)
+    {
+        keys[static_cast<size_t> (id)] = key;
+        heap[static_cast<size_t> (size)] = id;
+        position[static_cast<size_t> (id)] = size;
+        siftUp (size++);
+    }
+
+    /** Remove an id if it is in the heap. */
+    void remove (int id)
+    {
+        const int index = position[static_cast<size_t> (id)];
+        if (index < 0)
+            return;
+
+        position[static_cast<size_t> (id)] = -1;
+        --size;
+
+        if (index == size)
+            return;
+
+        // Move the last entry into the hole and restore the heap order around it
+        place (index, heap[static_cast<size_t> (size)]);
+        siftUp (index);
+        siftDown (position[static_cast<size_t> (heap[static_cast<size_t> (index)])]);
+    }
+
+    void clear()
+    {
+        for (int i = 0; i < size; ++i)
+            position[static_cast<size_t> (heap[static_cast<size_t> (i)])] = -1;
+        size = 0;
+    }
+
+private:
+    bool less (int a, int b) const
+    {
+        return keys[static_cast<size_t> (heap[static_cast<size_t> (a)])]
+             < keys[static_cast<size_t> (heap[static_cast<size_t> (b)])];
+    }
+
+    void place (int index, int id)
+    {
+        heap[static_cast<size_t> (index)] = id;
+        position[static_cast<size_t> (id)] = index;
+    }
+
+    void swapEntries (int a, int b)
+    {
+        const int idA = heap[static_cast<size_t> (a)];
+        place (a, heap[static_cast<size_t> (b)]);
+        place (b, idA);
+    }
+
+    void siftUp (int index)
+    {
+        while (index > 0)
+        {
+            const int parent = (index - 1) / 2;
+            if (! less (index, parent))
+                break;
+
+            swapEntries (index, parent);
+            index = parent;
+        }
+    }
+
+    void siftDown (int index)
+    {
+        for (;;)
+        {
+            const int left = 2 * index + 1;
+            if (left >= size)
+                break;
+
+            const int right = left + 1;
+            const int child = right < size && less (right, left) ? right : left;
+            if (! less (child, index))
+                break;
+
+            swapEntries (index, child);
+            index = child;
+        }
+    }
+
+    std::array<int, Capacity>    heap {};       // ids in heap order
+    std::array<int, Capacity>    position {};   // heap index of each id, -1 if absent
+    std::array<double, Capacity> keys {};       // key of each id
+    int size = 0;
+};
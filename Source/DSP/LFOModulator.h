@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "RandomGenerator.h"
 #include <cmath>
 #include <juce_core/juce_core.h>
 
@@ -39,16 +40,16 @@ public:
         currentSHValue = 0.0f;
     }
 
-    /** Advance by one sample and return the modulation value in [-1, 1].
-        rate in Hz, depth in [0, 1]. */
-    float process (float rate, LFOShape shape)
+    /** Advance by numSamples samples and return the modulation value in [-1, 1].
+        rate in Hz. The engine calls this once per control sub-block. */
+    float process (float rate, LFOShape shape, int numSamples = 1)
     {
         // Advance phase
         const float phaseInc = rate / static_cast<float> (sr);
-        phase += phaseInc;
-        if (phase >= 1.0f) 
+        phase += phaseInc * static_cast<float> (numSamples);
+        if (phase >= 1.0f)
         {
-            phase -= 1.0f;
+            phase -= std::floor (phase);
             // Trigger new S&H value at phase reset
             shTriggered = true;
         }
@@ -72,7 +73,7 @@ public:
             case LFOShape::SampleAndHold:
                 if (shTriggered)
                 {
-                    currentSHValue = random.nextFloat() * 2.0f - 1.0f;
+                    currentSHValue = random.nextBipolar();
                     shTriggered = false;
                 }
                 value = currentSHValue;
@@ -89,10 +90,16 @@ public:
         shTriggered = false;
     }
 
+    /** Restart the sample-and-hold sequence (see RandomGenerator::setSeed). */
+    void setSeed (juce::uint64 seed, juce::uint64 stream)
+    {
+        random.setSeed (seed, stream);
+    }
+
 private:
     double sr = 44100.0;
     float  phase = 0.0f;
     float  currentSHValue = 0.0f;
     bool   shTriggered = false;
-    juce::Random random;
+    RandomGenerator random;
 };
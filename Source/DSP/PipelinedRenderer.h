@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+    PipelinedRenderer.h
+    Runs GranularEngine one block behind the host on its own real-time thread.
+    The host callback only hands over its input and takes back the output
+    rendered during the previous callback, so rendering gets a whole buffer
+    period instead of what is left of the host's deadline, at the cost of
+    getLatencySamples() samples of latency.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "EngineParams.h"
+#include "GranularEngine.h"
+#include "../Utils/RealtimeWorkerPool.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <atomic>
+
+class PipelinedRenderer : private juce::Thread
+{
+public:
+    explicit PipelinedRenderer (GranularEngine& engineToRun)
+        : juce::Thread ("Grain Render"), engine (engineToRun)
+    {
+    }
+
+    ~PipelinedRenderer() override { stop(); }
+
+    /** Allocate for blocks of up to samplesPerBlock, which is also the added
+        latency, and start the render thread. Not for the audio thread. */
+    void prepare (double sampleRate, int samplesPerBlock, int numChannels)
+    {
+        stop();
+
+        latency = samplesPerBlock;
+        job.setSize (numChannels, samplesPerBlock);
+        output.setSize (numChannels, 2 * samplesPerBlock);
+        reset();
+
+        startRealtimeThread (juce::Thread::RealtimeOptions()
+                                 .withPriority (9)
+                                 .withApproximateAudioProcessingTime (samplesPerBlock, sampleRate));
+    }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (1000);
+        rendering.store (false);
+    }
+
+    /** Samples between a block going in and its rendered output coming out. */
+    int getLatencySamples() const { return latency; }
+
+    /** Wait for the block in flight and start over from latency samples of silence. */
+    void reset()
+    {
+        waitForRender();
+
+        output.clear();
+        readPos = 0;
+        numBuffered = latency;
+    }
+
+    /** Audio thread: replace buffer's input with the output latency samples back,
+        and queue the input for rendering. Blocks longer than the prepared size go
+        through in prepared-size chunks, so the latency stays the same. */
+    void process (juce::AudioBuffer<float>& buffer, const EngineParams& params)
+    {
+        const int numSamples = buffer.getNumSamples();
+
+        for (int start = 0; start < numSamples; start += latency)
+        {
+            const int n = juce::jmin (latency, numSamples - start);
+            exchange (buffer, start, n, params);
+        }
+    }
+
+private:
+    void exchange (juce::AudioBuffer<float>& buffer, int start, int numSamples, const EngineParams& params)
+    {
+        // The previous block normally finished long ago; if it did not, this
+        // callback is late whichever thread does the waiting
+        waitForRender();
+
+        const int numChannels = juce::jmin (buffer.getNumChannels(), job.getNumChannels());
+        const int size = output.getNumSamples();
+        const int firstPart = juce::jmin (numSamples, size - readPos);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            job.copyFrom (ch, 0, buffer, ch, start, numSamples);
+
+            buffer.copyFrom (ch, start, output, ch, readPos, firstPart);
+            buffer.copyFrom (ch, start + firstPart, output, ch, 0, numSamples - firstPart);
+        }
+
+        readPos = (readPos + numSamples) % size;
+        numBuffered -= numSamples;
+
+        jobSamples = numSamples;
+        jobParams = params;
+        rendering.store (true, std::memory_order_release);
+        notify();
+    }
+
+    void waitForRender() const
+    {
+        while (rendering.load (std::memory_order_acquire))
+            RealtimeWorkerPool::pause();
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            wait (-1);
+
+            if (! rendering.load (std::memory_order_acquire))
+                continue;
+
+            juce::AudioBuffer<float> block (job.getArrayOfWritePointers(), job.getNumChannels(), jobSamples);
+            engine.process (block, jobParams);
+
+            const int size = output.getNumSamples();
+            const int writePos = (readPos + numBuffered) % size;
+            const int firstPart = juce::jmin (jobSamples, size - writePos);
+
+            for (int ch = 0; ch < job.getNumChannels(); ++ch)
+            {
+                output.copyFrom (ch, writePos, job, ch, 0, firstPart);
+                output.copyFrom (ch, 0, job, ch, firstPart, jobSamples - firstPart);
+            }
+
+            numBuffered += jobSamples;
+            rendering.store (false, std::memory_order_release);
+        }
+    }
+
+    GranularEngine& engine;
+    int latency = 0;
+
+    // Owned by whichever thread rendering hands them to
+    juce::AudioBuffer<float> job;
+    int jobSamples = 0;
+    EngineParams jobParams;
+
+    // Rendered output waiting for the host, numBuffered samples from readPos
+    juce::AudioBuffer<float> output;
+    int readPos = 0;
+    int numBuffered = 0;
+
+    std::atomic<bool> rendering { false };
+
+    JUCE_DECLARE_NON_COPYABLE (PipelinedRenderer)
+};
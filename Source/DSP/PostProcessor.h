@@ -9,6 +9,7 @@
 
 #include <juce_dsp/juce_dsp.h>
 #include <juce_audio_basics/juce_audio_basics.h>
+#include "SimdKernels.h"
 #include <cmath>
 
 class PostProcessor
@@ -45,26 +46,30 @@ public:
         shimmerDampen.prepare (spec);
         shimmerDampen.setType (juce::dsp::StateVariableTPTFilterType::lowpass);
         shimmerDampen.setCutoffFrequency (8000.0f);
+
+        currentWidth = 1.0f;
     }
 
-    /** Process a stereo block in-place. */
-    void process (juce::AudioBuffer<float>& buffer,
+    /** Process numSamples samples of a stereo block in-place, from startSample.
+        The engine calls this once per control sub-block with smoothed cutoffs and
+        width; the width is ramped linearly from the previous call's value. */
+    void process (juce::AudioBuffer<float>& buffer, int startSample, int numSamples,
                   float lowCutFreq, float highCutFreq,
                   float stereoWidth, float shimmerAmount,
                   juce::AudioBuffer<float>& /*shimmerFeedbackOut*/)
     {
-        const int numSamples = buffer.getNumSamples();
         const int bufChannels = buffer.getNumChannels();
 
         // Apply DC blocker first (removes DC offset from grain summing)
-        applyDCBlocker (buffer);
+        applyDCBlocker (buffer, startSample, numSamples);
 
-        // Update filter cutoffs (only if changed significantly to avoid zipper noise)
+        // Cutoffs are already smoothed, so they can follow every sub-block
         highPassFilter.setCutoffFrequency (lowCutFreq);
         lowPassFilter.setCutoffFrequency (highCutFreq);
 
         // Apply filters
-        juce::dsp::AudioBlock<float> block (buffer);
+        auto block = juce::dsp::AudioBlock<float> (buffer).getSubBlock (static_cast<size_t> (startSample),
+                                                                       static_cast<size_t> (numSamples));
         juce::dsp::ProcessContextReplacing<float> context (block);
         highPassFilter.process (context);
         lowPassFilter.process (context);
@@ -72,22 +77,13 @@ public:
         // Stereo width (Mid/Side processing)
         if (bufChannels >= 2)
         {
-            const float widthFactor = stereoWidth / 100.0f;  // 0-2 range
-
-            for (int s = 0; s < numSamples; ++s)
-            {
-                const float left  = buffer.getSample (0, s);
-                const float right = buffer.getSample (1, s);
-
-                const float mid  = (left + right) * 0.5f;
-                const float side = (left - right) * 0.5f;
+            const float targetWidth = stereoWidth / 100.0f;  // 0-2 range
+            const float widthStep = (targetWidth - currentWidth) / static_cast<float> (numSamples);
 
-                const float newLeft  = mid + side * widthFactor;
-                const float newRight = mid - side * widthFactor;
+            kernels->widen (buffer.getWritePointer (0, startSample), buffer.getWritePointer (1, startSample),
+                           numSamples, currentWidth, widthStep);
 
-                buffer.setSample (0, s, newLeft);
-                buffer.setSample (1, s, newRight);
-            }
+            currentWidth = targetWidth;
         }
 
         // Shimmer: proper pitch-shifted (octave-up) delay with feedback
@@ -95,7 +91,7 @@ public:
         {
             const float shimMix = shimmerAmount / 100.0f;
 
-            for (int s = 0; s < numSamples; ++s)
+            for (int s = startSample; s < startSample + numSamples; ++s)
             {
                 for (int ch = 0; ch < juce::jmin (bufChannels, 2); ++ch)
                 {
@@ -133,7 +129,12 @@ public:
         }
 
         // Soft clip the entire output to prevent harsh digital distortion
-        applySoftClip (buffer);
+        applySoftClip (buffer, startSample, numSamples);
+    }
+
+    void setKernels (const SimdKernels::Kernels& newKernels)
+    {
+        kernels = &newKernels;
     }
 
     void reset()
@@ -143,6 +144,7 @@ public:
         shimmerDampen.reset();
         shimmerBuffer.clear();
         shimmerWritePos = 0;
+        currentWidth = 1.0f;
 
         std::fill (dcBlockerX.begin(), dcBlockerX.end(), 0.0f);
         std::fill (dcBlockerY.begin(), dcBlockerY.end(), 0.0f);
@@ -150,10 +152,9 @@ public:
 
 private:
     /** DC blocking filter: y[n] = x[n] - x[n-1] + R * y[n-1], R ~= 0.995 */
-    void applyDCBlocker (juce::AudioBuffer<float>& buffer)
+    void applyDCBlocker (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
     {
         const float R = 0.995f;
-        const int numSamples = buffer.getNumSamples();
         const int bufChannels = buffer.getNumChannels();
 
         for (int ch = 0; ch < bufChannels; ++ch)
@@ -163,7 +164,7 @@ private:
 
             float xPrev = dcBlockerX[chIdx];
             float yPrev = dcBlockerY[chIdx];
-            auto* data = buffer.getWritePointer (ch);
+            auto* data = buffer.getWritePointer (ch, startSample);
 
             for (int s = 0; s < numSamples; ++s)
             {
@@ -180,20 +181,11 @@ private:
     }
 
     /** Soft clipping using tanh to prevent harsh digital distortion */
-    void applySoftClip (juce::AudioBuffer<float>& buffer)
+    void applySoftClip (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
     {
-        const int numSamples = buffer.getNumSamples();
-        const int bufChannels = buffer.getNumChannels();
-
-        for (int ch = 0; ch < bufChannels; ++ch)
-        {
-            auto* data = buffer.getWritePointer (ch);
-            for (int s = 0; s < numSamples; ++s)
-            {
-                // tanh soft clip — keeps signal in (-1, 1) range smoothly
-                data[s] = std::tanh (data[s]);
-            }
-        }
+        // tanh soft clip — keeps signal in (-1, 1) range smoothly
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            kernels->softClip (buffer.getWritePointer (ch, startSample), numSamples);
     }
 
     double sampleRate = 44100.0;
@@ -211,4 +203,9 @@ private:
     juce::AudioBuffer<float> shimmerBuffer;
     int shimmerWritePos = 0;
     int shimmerDelaySamples = 0;
+
+    // Width factor reached at the end of the previous call, ramp start for the next
+    float currentWidth = 1.0f;
+
+    const SimdKernels::Kernels* kernels = &SimdKernels::get();
 };
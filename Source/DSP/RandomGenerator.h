@@ -0,0 +1,356 @@
+/*
+  ==============================================================================
+    RandomGenerator.h
+    Seedable xoshiro128** streams for the audio thread, with uniform, Gaussian
+    and exponential (ziggurat) and Cauchy samplers. Every instance is seeded
+    explicitly, so a render with the same seed scatters grains the same way.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cmath>
+
+/** Shape of the random spread applied to scattered grain parameters. */
+enum class ScatterDistribution
+{
+    Uniform = 0,
+    Gaussian,
+    Exponential,   // two-sided (Laplace): most grains near the centre, long tails
+    Cauchy
+};
+
+class RandomGenerator
+{
+public:
+    /** Independent generators stepped in lockstep by the batch fills, so the
+        compiler can keep them in one vector register. */
+    static constexpr int kLanes = 4;
+
+    /** Uniform values fillScatter() draws from the lanes at a time. A grain
+        asks for fewer values than there are lanes, so they are generated
+        ahead and handed out over the next few grains. */
+    static constexpr int kBatchSize = 4 * kLanes;
+
+    explicit RandomGenerator (juce::uint64 seed = 0, juce::uint64 stream = 0)
+    {
+        getTables();   // build the ziggurat tables off the audio thread
+        setSeed (seed, stream);
+    }
+
+    /** Restart the sequence. Different stream numbers give unrelated sequences
+        for the same seed, so one seed can drive several generators. */
+    void setSeed (juce::uint64 seed, juce::uint64 stream = 0)
+    {
+        juce::uint64 x = seed ^ (stream * 0xd1b54a32d192ed03ull);
+
+        for (auto& word : state)
+            word = static_cast<juce::uint32> (splitMix (x) >> 32);
+
+        for (int k = 0; k < kLanes; ++k)
+        {
+            const auto lane = static_cast<size_t> (k);
+            const juce::uint64 a = splitMix (x), b = splitMix (x);
+            lanes[0][lane] = static_cast<juce::uint32> (a);
+            lanes[1][lane] = static_cast<juce::uint32> (a >> 32);
+            lanes[2][lane] = static_cast<juce::uint32> (b);
+            lanes[3][lane] = static_cast<juce::uint32> (b >> 32);
+        }
+
+        batchPos = kBatchSize;
+    }
+
+    juce::uint32 nextUInt32()
+    {
+        return step (state[0], state[1], state[2], state[3]);
+    }
+
+    /** Uniform in [0, 1). */
+    float nextFloat()         { return toUnit (nextUInt32()); }
+
+    /** Uniform in [-1, 1). */
+    float nextBipolar()       { return nextFloat() * 2.0f - 1.0f; }
+
+    /** Standard normal (mean 0, deviation 1), Marsaglia-Tsang ziggurat. */
+    float nextGaussian()
+    {
+        const auto& t = getTables();
+        const auto hz = static_cast<juce::int32> (nextUInt32());
+        const auto iz = static_cast<size_t> (hz & 127);
+
+        if (std::abs (static_cast<juce::int64> (hz)) < t.kn[iz])
+            return static_cast<float> (hz) * t.wn[iz];
+
+        return gaussianTail (hz, iz);
+    }
+
+    /** Exponential with rate 1, Marsaglia-Tsang ziggurat. */
+    float nextExponential()
+    {
+        const auto& t = getTables();
+        const juce::uint32 jz = nextUInt32();
+        const auto iz = static_cast<size_t> (jz & 255);
+
+        if (jz < t.ke[iz])
+            return static_cast<float> (jz) * t.we[iz];
+
+        return exponentialTail (jz, iz);
+    }
+
+    /** Standard Cauchy (location 0, scale 1). */
+    float nextCauchy()
+    {
+        return std::tan (juce::MathConstants<float>::pi * (nextFloat() - 0.5f));
+    }
+
+    /** Scatter value in [-1, 1] with the given distribution. Uniform covers the
+        range evenly; the others concentrate near 0 and are clipped at the edges. */
+    float nextScatter (ScatterDistribution distribution)
+    {
+        switch (distribution)
+        {
+            case ScatterDistribution::Gaussian:
+                return clipScatter (nextGaussian() * kGaussianScale);
+            case ScatterDistribution::Exponential:
+                return clipScatter ((nextUInt32() & 1u) != 0 ? nextExponential() * kExponentialScale
+                                                             : -nextExponential() * kExponentialScale);
+            case ScatterDistribution::Cauchy:
+                return clipScatter (nextCauchy() * kCauchyScale);
+            case ScatterDistribution::Uniform:
+            default:
+                return nextBipolar();
+        }
+    }
+
+    /** Fill dest with numValues uniform values in [0, 1), kLanes at a time. */
+    void fillUniform (float* dest, int numValues)
+    {
+        int i = 0;
+
+        for (; i + kLanes <= numValues; i += kLanes)
+            for (int k = 0; k < kLanes; ++k)
+            {
+                const auto lane = static_cast<size_t> (k);
+                dest[i + k] = toUnit (step (lanes[0][lane], lanes[1][lane], lanes[2][lane], lanes[3][lane]));
+            }
+
+        for (; i < numValues; ++i)
+            dest[i] = nextFloat();
+    }
+
+    /** Fill dest with numValues scatter values with the spread of nextScatter().
+        Uniform and Cauchy values come from the batch, so they follow the lane
+        streams rather than the nextScatter() sequence; the order is still set
+        by the seed alone, whatever numValues each call asks for. */
+    void fillScatter (ScatterDistribution distribution, float* dest, int numValues)
+    {
+        switch (distribution)
+        {
+            case ScatterDistribution::Uniform:
+                for (int i = 0; i < numValues; ++i)
+                    dest[i] = nextBatchedUniform() * 2.0f - 1.0f;
+                break;
+
+            case ScatterDistribution::Cauchy:
+                for (int i = 0; i < numValues; ++i)
+                    dest[i] = clipScatter (std::tan (juce::MathConstants<float>::pi * (nextBatchedUniform() - 0.5f)) * kCauchyScale);
+                break;
+
+            case ScatterDistribution::Gaussian:
+            case ScatterDistribution::Exponential:
+            default:
+                // Ziggurat rejection branches per value, so these stay scalar
+                for (int i = 0; i < numValues; ++i)
+                    dest[i] = nextScatter (distribution);
+                break;
+        }
+    }
+
+private:
+    // Spread of the peaked distributions within [-1, 1]
+    static constexpr float kGaussianScale    = 1.0f / 3.0f;   // 3 sigma at the edges
+    static constexpr float kExponentialScale = 0.2f;          // ~99% inside the range
+    static constexpr float kCauchyScale      = 0.1f;          // heavy tails pile up at the edges
+
+    /** Ziggurat layer tables (Marsaglia & Tsang, "The Ziggurat Method for
+        Generating Random Variables", 2000): 128 layers for the normal, 256 for
+        the exponential. */
+    struct Tables
+    {
+        std::array<juce::int64, 128>  kn {};
+        std::array<float, 128>        wn {}, fn {};
+        std::array<juce::uint32, 256> ke {};
+        std::array<float, 256>        we {}, fe {};
+
+        Tables()
+        {
+            const double m1 = 2147483648.0, m2 = 4294967296.0;
+
+            double dn = kGaussianR, tn = dn;
+            const double vn = 9.91256303526217e-3;
+            const double qn = vn / std::exp (-0.5 * dn * dn);
+            kn[0] = static_cast<juce::int64> ((dn / qn) * m1);
+            kn[1] = 0;
+            wn[0] = static_cast<float> (qn / m1);
+            wn[127] = static_cast<float> (dn / m1);
+            fn[0] = 1.0f;
+            fn[127] = static_cast<float> (std::exp (-0.5 * dn * dn));
+
+            for (int i = 126; i >= 1; --i)
+            {
+                const auto k = static_cast<size_t> (i);
+                dn = std::sqrt (-2.0 * std::log (vn / dn + std::exp (-0.5 * dn * dn)));
+                kn[k + 1] = static_cast<juce::int64> ((dn / tn) * m1);
+                tn = dn;
+                fn[k] = static_cast<float> (std::exp (-0.5 * dn * dn));
+                wn[k] = static_cast<float> (dn / m1);
+            }
+
+            double de = kExponentialR, te = de;
+            const double ve = 3.949659822581572e-3;
+            const double qe = ve / std::exp (-de);
+            ke[0] = static_cast<juce::uint32> ((de / qe) * m2);
+            ke[1] = 0;
+            we[0] = static_cast<float> (qe / m2);
+            we[255] = static_cast<float> (de / m2);
+            fe[0] = 1.0f;
+            fe[255] = static_cast<float> (std::exp (-de));
+
+            for (int i = 254; i >= 1; --i)
+            {
+                const auto k = static_cast<size_t> (i);
+                de = -std::log (ve / de + std::exp (-de));
+                ke[k + 1] = static_cast<juce::uint32> ((de / te) * m2);
+                te = de;
+                fe[k] = static_cast<float> (std::exp (-de));
+                we[k] = static_cast<float> (de / m2);
+            }
+        }
+    };
+
+    static constexpr double kGaussianR    = 3.442619855899;    // start of the normal tail
+    static constexpr double kExponentialR = 7.697117470131487; // start of the exponential tail
+
+    static const Tables& getTables()
+    {
+        static const Tables tables;
+        return tables;
+    }
+
+    float gaussianTail (juce::int32 hz, size_t iz)
+    {
+        const auto& t = getTables();
+
+        for (;;)
+        {
+            if (iz == 0)
+            {
+                // Sample the tail beyond r
+                float x, y;
+                do
+                {
+                    x = -std::log (nextOpenUnit()) * static_cast<float> (1.0 / kGaussianR);
+                    y = -std::log (nextOpenUnit());
+                } while (y + y < x * x);
+
+                return hz > 0 ? static_cast<float> (kGaussianR) + x : -static_cast<float> (kGaussianR) - x;
+            }
+
+            const float x = static_cast<float> (hz) * t.wn[iz];
+            if (t.fn[iz] + nextFloat() * (t.fn[iz - 1] - t.fn[iz]) < std::exp (-0.5f * x * x))
+                return x;
+
+            hz = static_cast<juce::int32> (nextUInt32());
+            iz = static_cast<size_t> (hz & 127);
+
+            if (std::abs (static_cast<juce::int64> (hz)) < t.kn[iz])
+                return static_cast<float> (hz) * t.wn[iz];
+        }
+    }
+
+    float exponentialTail (juce::uint32 jz, size_t iz)
+    {
+        const auto& t = getTables();
+
+        for (;;)
+        {
+            if (iz == 0)
+                return static_cast<float> (kExponentialR) - std::log (nextOpenUnit());
+
+            const float x = static_cast<float> (jz) * t.we[iz];
+            if (t.fe[iz] + nextFloat() * (t.fe[iz - 1] - t.fe[iz]) < std::exp (-x))
+                return x;
+
+            jz = nextUInt32();
+            iz = static_cast<size_t> (jz & 255);
+
+            if (jz < t.ke[iz])
+                return static_cast<float> (jz) * t.we[iz];
+        }
+    }
+
+    /** Next value of the uniform batch, refilled through the lanes when spent. */
+    float nextBatchedUniform()
+    {
+        if (batchPos == kBatchSize)
+        {
+            fillUniform (uniformBatch.data(), kBatchSize);
+            batchPos = 0;
+        }
+
+        return uniformBatch[static_cast<size_t> (batchPos++)];
+    }
+
+    /** Uniform in (0, 1], safe for log(). */
+    float nextOpenUnit()
+    {
+        return static_cast<float> ((nextUInt32() >> 8) + 1) * (1.0f / 16777216.0f);
+    }
+
+    static float toUnit (juce::uint32 x)
+    {
+        return static_cast<float> (x >> 8) * (1.0f / 16777216.0f);
+    }
+
+    static float clipScatter (float x)
+    {
+        return juce::jlimit (-1.0f, 1.0f, x);
+    }
+
+    static juce::uint32 rotl (juce::uint32 x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    /** One xoshiro128** step (Blackman & Vigna). */
+    static juce::uint32 step (juce::uint32& s0, juce::uint32& s1, juce::uint32& s2, juce::uint32& s3)
+    {
+        const juce::uint32 result = rotl (s1 * 5u, 7) * 9u;
+        const juce::uint32 t = s1 << 9;
+
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = rotl (s3, 11);
+
+        return result;
+    }
+
+    /** SplitMix64, used to expand a seed into generator state. */
+    static juce::uint64 splitMix (juce::uint64& x)
+    {
+        juce::uint64 z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    std::array<juce::uint32, 4> state {};
+    std::array<std::array<juce::uint32, kLanes>, 4> lanes {};   // [state word][lane]
+    std::array<float, kBatchSize> uniformBatch {};
+    int batchPos = kBatchSize;                                  // next unread batch value
+};
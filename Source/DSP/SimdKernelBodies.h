@@ -0,0 +1,224 @@
+/*
+  ==============================================================================
+    SimdKernelBodies.h
+    Kernel bodies shared by every instruction set. SimdKernels.h includes this
+    file inside each instruction-set namespace, after defining that namespace's
+    Float / Int / Mask types, kWidth and the operations on them, so it has no
+    include guard and includes nothing itself.
+
+    Each kernel walks its span kWidth samples at a time; a short last chunk is
+    padded through a stack copy rather than handled by a separate scalar tail,
+    so every sample goes through the same arithmetic.
+  ==============================================================================
+*/
+
+/** Load count (<= kWidth) values; lanes past count read as zero. */
+inline Float loadPartial (const float* p, int count)
+{
+    if (count == kWidth)
+        return load (p);
+
+    alignas (64) float temp[kWidth] {};
+    std::copy (p, p + count, temp);
+    return load (temp);
+}
+
+/** Store the first count (<= kWidth) lanes. */
+inline void storePartial (float* p, Float a, int count)
+{
+    if (count == kWidth)
+    {
+        store (p, a);
+        return;
+    }
+
+    alignas (64) float temp[kWidth];
+    store (temp, a);
+    std::copy (temp, temp + count, p);
+}
+
+/** Normalised grain positions start + (i .. i + kWidth - 1) * increment. */
+inline Float positions (float start, float increment, int i)
+{
+    return start + (Float (static_cast<float> (i)) + lanes()) * increment;
+}
+
+/** GrainEnvelope::ramp */
+inline Float ramp (Float pos, Float attackInv, Float decayInv)
+{
+    pos = min (max (pos, 0.0f), 1.0f);
+    return min (min (1.0f, pos * attackInv), (1.0f - pos) * decayInv);
+}
+
+/** GrainEnvelope::lookup */
+inline Float lookup (const float* table, Float u)
+{
+    const Float x = u * static_cast<float> (GrainEnvelope::kTableSize);
+    const Int i = truncate (x);
+    const Float frac = x - toFloat (i);
+    const Float t0 = gather (table, i);
+    return t0 + frac * (gather (table + 1, i) - t0);
+}
+
+/** e^x for x in [0, 2 * kTanhMax] (Cephes expf). */
+inline Float expApprox (Float x)
+{
+    const Float n = floor (x * detail::kLog2e + 0.5f);
+    x = x - n * detail::kExpC1;
+    x = x - n * detail::kExpC2;
+
+    const Float z = x * x;
+    const Float y = (((((1.9875691500e-4f * x + 1.3981999507e-3f) * x + 8.3334519073e-3f) * x
+                       + 4.1665795894e-2f) * x + 1.6666665459e-1f) * x + 5.0000001201e-1f) * z + x + 1.0f;
+
+    return y * exp2Int (n);
+}
+
+/** tanh within a couple of ulp (Cephes tanhf): an odd polynomial near zero,
+    1 - 2 / (e^2|x| + 1) further out. */
+inline Float tanhApprox (Float x)
+{
+    const Float a = min (abs (x), detail::kTanhMax);
+
+    const Float z = a * a;
+    const Float inner = ((((-5.70498872745e-3f * z + 2.06390887954e-2f) * z - 5.37397155531e-2f) * z
+                         + 1.33314422036e-1f) * z - 3.33332819422e-1f) * z * a + a;
+    const Float outer = 1.0f - 2.0f / (expApprox (a + a) + 1.0f);
+
+    return copySign (select (lessThan (a, detail::kTanhSmall), inner, outer), x);
+}
+
+//==============================================================================
+inline void fillEnvelope (float* dest, int numSamples, float startPos, float posIncrement,
+                          float attackInv, float decayInv, const float* table)
+{
+    for (int i = 0; i < numSamples; i += kWidth)
+        storePartial (dest + i, lookup (table, ramp (positions (startPos, posIncrement, i), attackInv, decayInv)),
+                      std::min (kWidth, numSamples - i));
+}
+
+inline void fillRamp (float* dest, int numSamples, float startPos, float posIncrement,
+                      float attackInv, float decayInv)
+{
+    for (int i = 0; i < numSamples; i += kWidth)
+        storePartial (dest + i, ramp (positions (startPos, posIncrement, i), attackInv, decayInv),
+                      std::min (kWidth, numSamples - i));
+}
+
+inline void readHermiteStereo (const CircularBuffer::Ring& ring, GrainPool::Phase phase, GrainPool::Phase increment,
+                               int numSamples, float* left, float* right)
+{
+    alignas (64) int index[kWidth] {};
+    alignas (64) float frac[kWidth] {};
+    const float* y = ring.frames;
+
+    for (int i = 0; i < numSamples; i += kWidth)
+    {
+        const int count = std::min (kWidth, numSamples - i);
+        phase = detail::fillPhases (phase, increment, ring.mask, index, frac, count);
+
+        const Int frame = loadInt (index);
+        const Float t  = load (frac);
+        const Float t2 = t * t;
+        const Float t3 = t2 * t;
+
+        // Hermite (Catmull-Rom) weights for the taps at whole - 1 .. whole + 2
+        const Float wm1 = -0.5f * t + t2 - 0.5f * t3;
+        const Float w0  = 1.0f - 2.5f * t2 + 1.5f * t3;
+        const Float w1  = 0.5f * t + 2.0f * t2 - 1.5f * t3;
+        const Float w2  = -0.5f * t2 + 0.5f * t3;
+
+        // Four interleaved frames: L-1 R-1 L0 R0 L1 R1 L2 R2
+        storePartial (left + i,  (wm1 * gather (y, frame)     + w1 * gather (y + 4, frame))
+                               + (w0  * gather (y + 2, frame) + w2 * gather (y + 6, frame)), count);
+        storePartial (right + i, (wm1 * gather (y + 1, frame) + w1 * gather (y + 5, frame))
+                               + (w0  * gather (y + 3, frame) + w2 * gather (y + 7, frame)), count);
+    }
+}
+
+inline void readHermiteMono (const CircularBuffer::Ring& ring, GrainPool::Phase phase, GrainPool::Phase increment,
+                             int numSamples, float* dest)
+{
+    alignas (64) int index[kWidth] {};
+    alignas (64) float frac[kWidth] {};
+    const float* y = ring.frames;
+
+    for (int i = 0; i < numSamples; i += kWidth)
+    {
+        const int count = std::min (kWidth, numSamples - i);
+        phase = detail::fillPhases (phase, increment, ring.mask, index, frac, count);
+
+        const Int frame = loadInt (index);
+        const Float t   = load (frac);
+        const Float ym1 = gather (y, frame);
+        const Float y0  = gather (y + 2, frame);
+        const Float y1  = gather (y + 4, frame);
+        const Float y2  = gather (y + 6, frame);
+
+        const Float c1 = 0.5f * (y1 - ym1);
+        const Float c2 = ym1 - 2.5f * y0 + 2.0f * y1 - 0.5f * y2;
+        const Float c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+
+        storePartial (dest + i, ((c3 * t + c2) * t + c1) * t + y0, count);
+    }
+}
+
+inline void mixStereo (float* outL, float* outR, float* count, const float* left, const float* right,
+                       const float* env, float gainL, float gainR, int numSamples)
+{
+    for (int i = 0; i < numSamples; i += kWidth)
+    {
+        const int n = std::min (kWidth, numSamples - i);
+        const Float e = loadPartial (env + i, n);
+
+        storePartial (outL + i,  loadPartial (outL + i, n) + loadPartial (left + i, n) * e * gainL, n);
+        storePartial (outR + i,  loadPartial (outR + i, n) + loadPartial (right + i, n) * e * gainR, n);
+        storePartial (count + i, loadPartial (count + i, n) + 1.0f, n);
+    }
+}
+
+inline void mixMono (float* out, float* count, const float* source, const float* env, float gain, int numSamples)
+{
+    for (int i = 0; i < numSamples; i += kWidth)
+    {
+        const int n = std::min (kWidth, numSamples - i);
+
+        storePartial (out + i,   loadPartial (out + i, n) + loadPartial (source + i, n) * loadPartial (env + i, n) * gain, n);
+        storePartial (count + i, loadPartial (count + i, n) + 1.0f, n);
+    }
+}
+
+inline void normalise (float* data, const float* counts, int numSamples)
+{
+    for (int i = 0; i < numSamples; i += kWidth)
+    {
+        const int n = std::min (kWidth, numSamples - i);
+        storePartial (data + i, loadPartial (data + i, n) * (1.0f / sqrt (max (loadPartial (counts + i, n), 1.0f))), n);
+    }
+}
+
+inline void widen (float* left, float* right, int numSamples, float startWidth, float widthStep)
+{
+    for (int i = 0; i < numSamples; i += kWidth)
+    {
+        const int n = std::min (kWidth, numSamples - i);
+        const Float width = startWidth + widthStep * (Float (static_cast<float> (i + 1)) + lanes());
+        const Float l = loadPartial (left + i, n);
+        const Float r = loadPartial (right + i, n);
+
+        const Float mid  = (l + r) * 0.5f;
+        const Float side = (l - r) * 0.5f;
+
+        storePartial (left + i,  mid + side * width, n);
+        storePartial (right + i, mid - side * width, n);
+    }
+}
+
+inline void softClip (float* data, int numSamples)
+{
+    for (int i = 0; i < numSamples; i += kWidth)
+    {
+        const int n = std::min (kWidth, numSamples - i);
+        storePartial (data + i, tanhApprox (loadPartial (data + i, n)), n);
+    }
+}
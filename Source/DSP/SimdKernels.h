@@ -0,0 +1,428 @@
+/*
+  ==============================================================================
+    SimdKernels.h
+    The engine's hot inner loops (envelope fill, Hermite reads, grain mixing,
+    count normalisation, stereo width and soft clip), compiled once for each
+    instruction set and picked at startup from what the CPU supports.
+
+    Every instruction set runs the same kernel bodies (SimdKernelBodies.h)
+    over its own vector type, so they all evaluate the same arithmetic in the
+    same order. The scalar build of the bodies is the fallback on CPUs
+    without SSE4.1 and on non-Intel targets.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "CircularBuffer.h"
+#include "GrainPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace SimdKernels
+{
+    enum class InstructionSet
+    {
+        Scalar = 0,
+        SSE41,
+        AVX2,
+        AVX512
+    };
+
+    inline const char* getName (InstructionSet isa)
+    {
+        switch (isa)
+        {
+            case InstructionSet::SSE41:  return "SSE4.1";
+            case InstructionSet::AVX2:   return "AVX2";
+            case InstructionSet::AVX512: return "AVX-512";
+            case InstructionSet::Scalar:
+            default:                     return "Scalar";
+        }
+    }
+
+    /** Entry points for one instruction set. */
+    struct Kernels
+    {
+        InstructionSet instructionSet = InstructionSet::Scalar;
+
+        /** Envelope values through a shape table, as GrainEnvelope::getAmplitude. */
+        void (*fillEnvelope) (float* dest, int numSamples, float startPos, float posIncrement,
+                              float attackInv, float decayInv, const float* table);
+
+        /** Envelope values of the bare ramp (GrainEnvelope::Family::Ramp). */
+        void (*fillRamp) (float* dest, int numSamples, float startPos, float posIncrement,
+                          float attackInv, float decayInv);
+
+        /** Hermite reads of numSamples positions from phase, stepping by increment. */
+        void (*readHermiteStereo) (const CircularBuffer::Ring& ring, GrainPool::Phase phase,
+                                   GrainPool::Phase increment, int numSamples, float* left, float* right);
+        void (*readHermiteMono) (const CircularBuffer::Ring& ring, GrainPool::Phase phase,
+                                 GrainPool::Phase increment, int numSamples, float* dest);
+
+        /** out += source * env * gain, and count += 1, per sample. */
+        void (*mixStereo) (float* outL, float* outR, float* count, const float* left, const float* right,
+                           const float* env, float gainL, float gainR, int numSamples);
+        void (*mixMono) (float* out, float* count, const float* source, const float* env, float gain, int numSamples);
+
+        /** data *= 1 / sqrt (count) wherever count > 1. */
+        void (*normalise) (float* data, const float* counts, int numSamples);
+
+        /** Mid/side width, ramped from startWidth by widthStep per sample (first sample gets one step). */
+        void (*widen) (float* left, float* right, int numSamples, float startWidth, float widthStep);
+
+        /** tanh soft clip in place. */
+        void (*softClip) (float* data, int numSamples);
+    };
+
+    namespace detail
+    {
+        // Cephes single-precision constants for exp and tanh
+        constexpr float kLog2e       = 1.44269504088896341f;
+        constexpr float kExpC1       = 0.693359375f;
+        constexpr float kExpC2       = -2.12194440e-4f;
+        constexpr float kTanhMax     = 9.0f;      // tanh rounds to +-1 beyond this
+        constexpr float kTanhSmall   = 0.5493f;   // polynomial below, exp-based form above
+
+        /** Fill the grain phase of count lanes: stereo frame index of the first
+            Hermite tap, and the fraction. Lanes past count keep their last values. */
+        inline GrainPool::Phase fillPhases (GrainPool::Phase phase, GrainPool::Phase increment, int mask,
+                                            int* index, float* frac, int count)
+        {
+            for (int k = 0; k < count; ++k, phase += increment)
+            {
+                index[k] = ((GrainPool::phaseIndex (phase) - 1) & mask) * CircularBuffer::kFrameSize;
+                frac[k]  = GrainPool::phaseFraction (phase);
+            }
+
+            return phase;
+        }
+    }
+
+    //==============================================================================
+    // The sets only round alike if no compiler fuses a multiply and an add into
+    // an FMA, which it may where FMA is enabled (AVX-512F implies it).
+   #if defined (__clang__)
+    #pragma float_control (push)
+    #pragma clang fp contract (off)
+   #elif defined (__GNUC__)
+    #pragma GCC push_options
+    #pragma GCC optimize ("fp-contract=off")
+   #elif defined (_MSC_VER)
+    #pragma float_control (precise, on, push)
+    #pragma fp_contract (off)
+   #endif
+
+    //==============================================================================
+    namespace scalar
+    {
+        constexpr int kWidth = 1;
+
+        struct Float
+        {
+            Float (float x) : v (x) {}
+            float v;
+        };
+
+        struct Int { int v; };
+        using Mask = bool;
+
+        inline Float load (const float* p)         { return *p; }
+        inline void  store (float* p, Float a)     { *p = a.v; }
+        inline Int   loadInt (const int* p)        { return { *p }; }
+        inline Float lanes()                       { return 0.0f; }
+
+        inline Float operator+ (Float a, Float b)  { return a.v + b.v; }
+        inline Float operator- (Float a, Float b)  { return a.v - b.v; }
+        inline Float operator* (Float a, Float b)  { return a.v * b.v; }
+        inline Float operator/ (Float a, Float b)  { return a.v / b.v; }
+
+        inline Float min (Float a, Float b)        { return b.v < a.v ? b.v : a.v; }
+        inline Float max (Float a, Float b)        { return a.v < b.v ? b.v : a.v; }
+        inline Float sqrt (Float a)                { return std::sqrt (a.v); }
+        inline Float floor (Float a)               { return std::floor (a.v); }
+        inline Float abs (Float a)                 { return std::abs (a.v); }
+        inline Float copySign (Float m, Float s)   { return std::copysign (m.v, s.v); }
+        inline Mask  lessThan (Float a, Float b)   { return a.v < b.v; }
+        inline Float select (Mask m, Float a, Float b) { return m ? a : b; }
+        inline Int   truncate (Float a)            { return { static_cast<int> (a.v) }; }
+        inline Float toFloat (Int a)               { return static_cast<float> (a.v); }
+        inline Float gather (const float* base, Int index) { return base[index.v]; }
+
+        /** 2^n for integral n in the normal float range. */
+        inline Float exp2Int (Float n)
+        {
+            const auto bits = static_cast<juce::uint32> (static_cast<int> (n.v) + 127) << 23;
+            float result;
+            std::memcpy (&result, &bits, sizeof (result));
+            return result;
+        }
+
+       #include "SimdKernelBodies.h"
+    }
+
+    //==============================================================================
+   #if JUCE_INTEL
+
+   #if defined (__clang__)
+    #pragma clang attribute push (__attribute__ ((target ("sse4.1"))), apply_to = function)
+   #elif defined (__GNUC__)
+    #pragma GCC push_options
+    #pragma GCC target ("sse4.1")
+   #endif
+
+    namespace sse41
+    {
+        constexpr int kWidth = 4;
+
+        struct Float
+        {
+            Float (__m128 x) : v (x) {}
+            Float (float x) : v (_mm_set1_ps (x)) {}
+            __m128 v;
+        };
+
+        struct Int { __m128i v; };
+        using Mask = Float;
+
+        inline Float load (const float* p)         { return _mm_loadu_ps (p); }
+        inline void  store (float* p, Float a)     { _mm_storeu_ps (p, a.v); }
+        inline Int   loadInt (const int* p)        { return { _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p)) }; }
+        inline Float lanes()                       { return _mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f); }
+
+        inline Float operator+ (Float a, Float b)  { return _mm_add_ps (a.v, b.v); }
+        inline Float operator- (Float a, Float b)  { return _mm_sub_ps (a.v, b.v); }
+        inline Float operator* (Float a, Float b)  { return _mm_mul_ps (a.v, b.v); }
+        inline Float operator/ (Float a, Float b)  { return _mm_div_ps (a.v, b.v); }
+
+        inline Float min (Float a, Float b)        { return _mm_min_ps (a.v, b.v); }
+        inline Float max (Float a, Float b)        { return _mm_max_ps (a.v, b.v); }
+        inline Float sqrt (Float a)                { return _mm_sqrt_ps (a.v); }
+        inline Float floor (Float a)               { return _mm_floor_ps (a.v); }
+        inline Float abs (Float a)                 { return _mm_andnot_ps (_mm_set1_ps (-0.0f), a.v); }
+        inline Float copySign (Float m, Float s)   { return _mm_or_ps (m.v, _mm_and_ps (s.v, _mm_set1_ps (-0.0f))); }
+        inline Mask  lessThan (Float a, Float b)   { return _mm_cmplt_ps (a.v, b.v); }
+        inline Float select (Mask m, Float a, Float b) { return _mm_blendv_ps (b.v, a.v, m.v); }
+        inline Int   truncate (Float a)            { return { _mm_cvttps_epi32 (a.v) }; }
+        inline Float toFloat (Int a)               { return _mm_cvtepi32_ps (a.v); }
+
+        inline Float gather (const float* base, Int index)
+        {
+            // No gather instruction before AVX2
+            return _mm_setr_ps (base[_mm_extract_epi32 (index.v, 0)], base[_mm_extract_epi32 (index.v, 1)],
+                                base[_mm_extract_epi32 (index.v, 2)], base[_mm_extract_epi32 (index.v, 3)]);
+        }
+
+        inline Float exp2Int (Float n)
+        {
+            const __m128i bits = _mm_slli_epi32 (_mm_add_epi32 (_mm_cvttps_epi32 (n.v), _mm_set1_epi32 (127)), 23);
+            return _mm_castsi128_ps (bits);
+        }
+
+       #include "SimdKernelBodies.h"
+    }
+
+   #if defined (__clang__)
+    #pragma clang attribute pop
+   #elif defined (__GNUC__)
+    #pragma GCC pop_options
+   #endif
+
+    //==============================================================================
+   #if defined (__clang__)
+    #pragma clang attribute push (__attribute__ ((target ("avx2"))), apply_to = function)
+   #elif defined (__GNUC__)
+    #pragma GCC push_options
+    #pragma GCC target ("avx2")
+   #endif
+
+    namespace avx2
+    {
+        constexpr int kWidth = 8;
+
+        struct Float
+        {
+            Float (__m256 x) : v (x) {}
+            Float (float x) : v (_mm256_set1_ps (x)) {}
+            __m256 v;
+        };
+
+        struct Int { __m256i v; };
+        using Mask = Float;
+
+        inline Float load (const float* p)         { return _mm256_loadu_ps (p); }
+        inline void  store (float* p, Float a)     { _mm256_storeu_ps (p, a.v); }
+        inline Int   loadInt (const int* p)        { return { _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p)) }; }
+        inline Float lanes()                       { return _mm256_setr_ps (0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+
+        inline Float operator+ (Float a, Float b)  { return _mm256_add_ps (a.v, b.v); }
+        inline Float operator- (Float a, Float b)  { return _mm256_sub_ps (a.v, b.v); }
+        inline Float operator* (Float a, Float b)  { return _mm256_mul_ps (a.v, b.v); }
+        inline Float operator/ (Float a, Float b)  { return _mm256_div_ps (a.v, b.v); }
+
+        inline Float min (Float a, Float b)        { return _mm256_min_ps (a.v, b.v); }
+        inline Float max (Float a, Float b)        { return _mm256_max_ps (a.v, b.v); }
+        inline Float sqrt (Float a)                { return _mm256_sqrt_ps (a.v); }
+        inline Float floor (Float a)               { return _mm256_floor_ps (a.v); }
+        inline Float abs (Float a)                 { return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), a.v); }
+        inline Float copySign (Float m, Float s)   { return _mm256_or_ps (m.v, _mm256_and_ps (s.v, _mm256_set1_ps (-0.0f))); }
+        inline Mask  lessThan (Float a, Float b)   { return _mm256_cmp_ps (a.v, b.v, _CMP_LT_OQ); }
+        inline Float select (Mask m, Float a, Float b) { return _mm256_blendv_ps (b.v, a.v, m.v); }
+        inline Int   truncate (Float a)            { return { _mm256_cvttps_epi32 (a.v) }; }
+        inline Float toFloat (Int a)               { return _mm256_cvtepi32_ps (a.v); }
+        inline Float gather (const float* base, Int index) { return _mm256_i32gather_ps (base, index.v, 4); }
+
+        inline Float exp2Int (Float n)
+        {
+            const __m256i bits = _mm256_slli_epi32 (_mm256_add_epi32 (_mm256_cvttps_epi32 (n.v), _mm256_set1_epi32 (127)), 23);
+            return _mm256_castsi256_ps (bits);
+        }
+
+       #include "SimdKernelBodies.h"
+    }
+
+   #if defined (__clang__)
+    #pragma clang attribute pop
+   #elif defined (__GNUC__)
+    #pragma GCC pop_options
+   #endif
+
+    //==============================================================================
+   #if defined (__clang__)
+    #pragma clang attribute push (__attribute__ ((target ("avx512f"))), apply_to = function)
+   #elif defined (__GNUC__)
+    #pragma GCC push_options
+    #pragma GCC target ("avx512f")
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"   // false positive in GCC 12's avx512fintrin.h
+   #endif
+
+    namespace avx512
+    {
+        constexpr int kWidth = 16;
+
+        struct Float
+        {
+            Float (__m512 x) : v (x) {}
+            Float (float x) : v (_mm512_set1_ps (x)) {}
+            __m512 v;
+        };
+
+        struct Int { __m512i v; };
+        using Mask = __mmask16;
+
+        // AVX-512F has no float bitwise ops (those are AVX-512DQ), so sign work goes through integers
+        inline __m512i bits (Float a)              { return _mm512_castps_si512 (a.v); }
+        inline Float fromBits (__m512i a)          { return _mm512_castsi512_ps (a); }
+
+        inline Float load (const float* p)         { return _mm512_loadu_ps (p); }
+        inline void  store (float* p, Float a)     { _mm512_storeu_ps (p, a.v); }
+        inline Int   loadInt (const int* p)        { return { _mm512_loadu_si512 (p) }; }
+        inline Float lanes()                       { return _mm512_setr_ps (0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+                                                                            8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f); }
+
+        inline Float operator+ (Float a, Float b)  { return _mm512_add_ps (a.v, b.v); }
+        inline Float operator- (Float a, Float b)  { return _mm512_sub_ps (a.v, b.v); }
+        inline Float operator* (Float a, Float b)  { return _mm512_mul_ps (a.v, b.v); }
+        inline Float operator/ (Float a, Float b)  { return _mm512_div_ps (a.v, b.v); }
+
+        inline Float min (Float a, Float b)        { return _mm512_min_ps (a.v, b.v); }
+        inline Float max (Float a, Float b)        { return _mm512_max_ps (a.v, b.v); }
+        inline Float sqrt (Float a)                { return _mm512_sqrt_ps (a.v); }
+        inline Float floor (Float a)               { return _mm512_roundscale_ps (a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+        inline Float abs (Float a)                 { return fromBits (_mm512_and_si512 (bits (a), _mm512_set1_epi32 (0x7fffffff))); }
+
+        inline Float copySign (Float m, Float s)
+        {
+            return fromBits (_mm512_or_si512 (bits (m), _mm512_and_si512 (bits (s), _mm512_set1_epi32 (static_cast<int> (0x80000000u)))));
+        }
+
+        inline Mask  lessThan (Float a, Float b)   { return _mm512_cmp_ps_mask (a.v, b.v, _CMP_LT_OQ); }
+        inline Float select (Mask m, Float a, Float b) { return _mm512_mask_blend_ps (m, b.v, a.v); }
+        inline Int   truncate (Float a)            { return { _mm512_cvttps_epi32 (a.v) }; }
+        inline Float toFloat (Int a)               { return _mm512_cvtepi32_ps (a.v); }
+        inline Float gather (const float* base, Int index) { return _mm512_i32gather_ps (index.v, base, 4); }
+
+        inline Float exp2Int (Float n)
+        {
+            return fromBits (_mm512_slli_epi32 (_mm512_add_epi32 (_mm512_cvttps_epi32 (n.v), _mm512_set1_epi32 (127)), 23));
+        }
+
+       #include "SimdKernelBodies.h"
+    }
+
+   #if defined (__clang__)
+    #pragma clang attribute pop
+   #elif defined (__GNUC__)
+    #pragma GCC diagnostic pop
+    #pragma GCC pop_options
+   #endif
+
+   #endif   // JUCE_INTEL
+
+   #if defined (__clang__) || defined (_MSC_VER)
+    #pragma float_control (pop)
+   #elif defined (__GNUC__)
+    #pragma GCC pop_options
+   #endif
+
+    //==============================================================================
+    /** Best instruction set this CPU supports, among those compiled in. */
+    inline InstructionSet detectInstructionSet()
+    {
+       #if JUCE_INTEL
+        if (juce::SystemStats::hasAVX512F()) return InstructionSet::AVX512;
+        if (juce::SystemStats::hasAVX2())    return InstructionSet::AVX2;
+        if (juce::SystemStats::hasSSE41())   return InstructionSet::SSE41;
+       #endif
+
+        return InstructionSet::Scalar;
+    }
+
+    /** Kernels for an instruction set. Sets the CPU can't run fall back to the
+        best one it can, so this is also safe for forcing a slower path. */
+    inline const Kernels& get (InstructionSet isa)
+    {
+        #define SIMD_KERNELS_TABLE(ns, set) \
+            Kernels { set, ns::fillEnvelope, ns::fillRamp, ns::readHermiteStereo, ns::readHermiteMono, \
+                      ns::mixStereo, ns::mixMono, ns::normalise, ns::widen, ns::softClip }
+
+        static const Kernels scalarKernels = SIMD_KERNELS_TABLE (scalar, InstructionSet::Scalar);
+
+       #if JUCE_INTEL
+        static const Kernels sse41Kernels  = SIMD_KERNELS_TABLE (sse41,  InstructionSet::SSE41);
+        static const Kernels avx2Kernels   = SIMD_KERNELS_TABLE (avx2,   InstructionSet::AVX2);
+        static const Kernels avx512Kernels = SIMD_KERNELS_TABLE (avx512, InstructionSet::AVX512);
+
+        const auto supported = detectInstructionSet();
+        const auto chosen = static_cast<int> (isa) < static_cast<int> (supported) ? isa : supported;
+
+        switch (chosen)
+        {
+            case InstructionSet::AVX512: return avx512Kernels;
+            case InstructionSet::AVX2:   return avx2Kernels;
+            case InstructionSet::SSE41:  return sse41Kernels;
+            case InstructionSet::Scalar:
+            default:                     break;
+        }
+       #else
+        juce::ignoreUnused (isa);
+       #endif
+
+        #undef SIMD_KERNELS_TABLE
+        return scalarKernels;
+    }
+
+    /** Kernels for the best instruction set of this CPU, detected on the first call. */
+    inline const Kernels& get()
+    {
+        static const Kernels& best = get (detectInstructionSet());
+        return best;
+    }
+}
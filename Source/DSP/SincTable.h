@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+    SincTable.h
+    Precomputed polyphase windowed-sinc kernels for band-limited reads from
+    CircularBuffer. One kernel bank per cutoff, spaced in half octaves of
+    playback rate, so a grain reading faster than real time is low-passed
+    below its own Nyquist limit. The kernels get longer as the cutoff drops,
+    so every bank has the same transition band relative to its passband.
+    For grains at up to 8x, components they would fold back below 0.35 of
+    the sample rate are attenuated by at least 70 dB, and the response is
+    flat within 0.1 dB up to 0.4 of the grain's Nyquist limit.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cmath>
+#include <vector>
+
+class SincTable
+{
+public:
+    /** Fractional positions per kernel bank (nearest phase is used, plus one for frac == 1). */
+    static constexpr int kPhases = 256;
+
+    /** Cutoff banks: bank k serves playback rates up to 2^(k / 2), i.e. up to +36 st. */
+    static constexpr int kNumBanks = 7;
+
+    /** Taps per kernel in each bank: 16 * 2^(k / 2), rounded up to a multiple of 4. */
+    static constexpr std::array<int, kNumBanks> kBankTaps { 16, 24, 32, 48, 64, 92, 128 };
+
+    /** Longest kernel. A read at position p with n taps uses samples
+        floor(p) - (n / 2 - 1) .. floor(p) + n / 2. */
+    static constexpr int kMaxTaps = 128;
+
+    /** One cutoff's kernels: kPhases + 1 kernels of taps weights each. */
+    struct Bank
+    {
+        const float* kernels = nullptr;
+        int taps = 0;
+    };
+
+    SincTable()
+    {
+        int totalTaps = 0;
+        for (auto taps : kBankTaps)
+            totalTaps += (kPhases + 1) * taps;
+
+        kernels.resize (static_cast<size_t> (totalTaps));
+
+        float* dest = kernels.data();
+
+        for (int bank = 0; bank < kNumBanks; ++bank)
+        {
+            // Leave 10% transition band below the (scaled) Nyquist frequency
+            const double cutoff = 0.9 * std::pow (2.0, -0.5 * bank);
+            const int taps = kBankTaps[static_cast<size_t> (bank)];
+
+            banks[static_cast<size_t> (bank)] = { dest, taps };
+
+            for (int phase = 0; phase <= kPhases; ++phase, dest += taps)
+                buildKernel (cutoff, static_cast<double> (phase) / kPhases, taps, dest);
+        }
+    }
+
+    /** Kernel bank for a grain reading at the given playback rate (|rate|, >= 0). */
+    const Bank& getBank (float playbackRate) const
+    {
+        // Round up, so the cutoff never sits above the grain's Nyquist limit
+        const float octaves = playbackRate > 1.0f ? 2.0f * std::log2 (playbackRate) : 0.0f;
+        const int bank = juce::jlimit (0, kNumBanks - 1, static_cast<int> (std::ceil (octaves - 1.0e-3f)));
+        return banks[static_cast<size_t> (bank)];
+    }
+
+    /** Kernel within a bank for fractional position frac in [0, 1). */
+    static const float* getKernel (const Bank& bank, float frac)
+    {
+        return bank.kernels + static_cast<int> (frac * static_cast<float> (kPhases) + 0.5f) * bank.taps;
+    }
+
+private:
+    static void buildKernel (double cutoff, double frac, int numTaps, float* dest)
+    {
+        const double pi = juce::MathConstants<double>::pi;
+        const double halfWidth = numTaps / 2;
+        double sum = 0.0;
+        double taps[kMaxTaps];
+
+        for (int k = 0; k < numTaps; ++k)
+        {
+            // Distance from the read position to tap k (taps start at floor(p) - (numTaps / 2 - 1))
+            const double x = static_cast<double> (k - (numTaps / 2 - 1)) - frac;
+            const double sinc = std::abs (x) < 1.0e-9 ? 1.0 : std::sin (pi * cutoff * x) / (pi * cutoff * x);
+
+            // Blackman window over [-halfWidth, halfWidth]
+            const double n = juce::jlimit (0.0, 1.0, (x + halfWidth) / (2.0 * halfWidth));
+            const double window = 0.42 - 0.5 * std::cos (2.0 * pi * n) + 0.08 * std::cos (4.0 * pi * n);
+
+            taps[k] = sinc * window;
+            sum += taps[k];
+        }
+
+        // Unity gain at DC for every phase
+        for (int k = 0; k < numTaps; ++k)
+            dest[k] = static_cast<float> (taps[k] / sum);
+    }
+
+    std::vector<float> kernels;
+    std::array<Bank, kNumBanks> banks;
+
+    JUCE_DECLARE_NON_COPYABLE (SincTable)
+};
@@ -11,7 +11,8 @@
 GranularProcessorAudioProcessorEditor::GranularProcessorAudioProcessorEditor (GranularProcessorAudioProcessor& p)
     : AudioProcessorEditor (&p),
       audioProcessor (p),
-      presetBar (p.getAPVTS())
+      presetBar (p.getAPVTS()),
+      envelopeEditor (p.getAPVTS())
 {
     setLookAndFeel (&customLnf);
 
@@ -29,8 +30,10 @@ GranularProcessorAudioProcessorEditor::GranularProcessorAudioProcessorEditor (Gr
     // Add top bar
     addAndMakeVisible (presetBar);
 
-    // Add visualizer
+    // Add visualizer. The overlay is its child so it is drawn into the same GL frame.
     addAndMakeVisible (visualizer);
+    visualizer.addChildComponent (performanceHud);
+    presetBar.onPerformanceHudToggled = [this] (bool shouldShow) { performanceHud.setVisible (shouldShow); };
 
     // Add section panels
     addAndMakeVisible (grainPanel);
@@ -55,6 +58,16 @@ GranularProcessorAudioProcessorEditor::GranularProcessorAudioProcessorEditor (Gr
     knobPitch.attachToParameter (apvts, ParamIDs::grainPitch);
     knobPan.attachToParameter (apvts, ParamIDs::grainPan);
 
+    comboSpawnMode.addItemList ({ "Synchronous", "Quasi-Sync", "Poisson" }, 1);
+    grainPanel.addAndMakeVisible (comboSpawnMode);
+    spawnModeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
+        apvts, ParamIDs::spawnMode, comboSpawnMode);
+
+    comboDensityRange.addItemList ({ "Density x1", "Density x10", "Density x40" }, 1);
+    grainPanel.addAndMakeVisible (comboDensityRange);
+    densityRangeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
+        apvts, ParamIDs::densityRange, comboDensityRange);
+
     // --- Scatter knobs ---
     scatterPanel.addAndMakeVisible (knobPosScatter);
     scatterPanel.addAndMakeVisible (knobPitchScatter);
@@ -63,17 +76,30 @@ GranularProcessorAudioProcessorEditor::GranularProcessorAudioProcessorEditor (Gr
     knobPitchScatter.attachToParameter (apvts, ParamIDs::pitchScatter);
     knobPanScatter.attachToParameter (apvts, ParamIDs::panScatter);
 
+    comboScatterShape.addItemList ({ "Uniform", "Gaussian", "Exponential", "Cauchy" }, 1);
+    scatterPanel.addAndMakeVisible (comboScatterShape);
+    scatterShapeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
+        apvts, ParamIDs::scatterShape, comboScatterShape);
+
     // --- Envelope ---
     envelopePanel.addAndMakeVisible (knobAttack);
     envelopePanel.addAndMakeVisible (knobDecay);
     knobAttack.attachToParameter (apvts, ParamIDs::grainAttack);
     knobDecay.attachToParameter (apvts, ParamIDs::grainDecay);
 
-    comboEnvShape.addItemList ({ "Hanning", "Gaussian", "Triangle", "Trapezoid" }, 1);
+    comboEnvShape.addItemList ({ "Hanning", "Gaussian", "Triangle", "Trapezoid",
+                                 "Tukey", "Blackman-Harris", "Kaiser", "Exp Decay", "Custom" }, 1);
     envelopePanel.addAndMakeVisible (comboEnvShape);
     envShapeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
         apvts, ParamIDs::envelopeShape, comboEnvShape);
 
+    envelopePanel.addAndMakeVisible (envelopeEditor);
+    envelopeEditor.setCustomPoints (audioProcessor.getCustomEnvelope());
+    envelopeEditor.onCustomPointsChanged = [this] (const GrainEnvelope::CustomPoints& points)
+    {
+        audioProcessor.setCustomEnvelope (points);
+    };
+
     // --- Effects ---
     effectsPanel.addAndMakeVisible (knobFeedback);
     effectsPanel.addAndMakeVisible (knobShimmer);
@@ -129,6 +155,9 @@ GranularProcessorAudioProcessorEditor::~GranularProcessorAudioProcessorEditor()
 void GranularProcessorAudioProcessorEditor::timerCallback()
 {
     visualizer.updateGrainData (audioProcessor.getGranularEngine().getVisualData());
+
+    if (performanceHud.isVisible())
+        performanceHud.updateStats (audioProcessor.getGranularEngine().getStats());
 }
 
 void GranularProcessorAudioProcessorEditor::paint (juce::Graphics& g)
@@ -148,6 +177,7 @@ void GranularProcessorAudioProcessorEditor::resized()
     // 2) Visualizer (~ 38% of remaining height)
     const int vizHeight = static_cast<int> ((bounds.getHeight()) * 0.38f);
     visualizer.setBounds (bounds.removeFromTop (vizHeight).reduced (margin, margin / 2));
+    performanceHud.setBounds (visualizer.getLocalBounds().reduced (6).removeFromRight (300));
 
     // 3) Middle row: Grain | Scatter | Envelope | Effects
     const int middleRowHeight = static_cast<int> ((bounds.getHeight()) * 0.52f);
@@ -174,6 +204,10 @@ void GranularProcessorAudioProcessorEditor::resized()
     // Grain panel
     {
         auto area = grainPanel.getContentArea();
+        auto comboRow = area.removeFromBottom (24);
+        comboDensityRange.setBounds (comboRow.removeFromRight (comboRow.getWidth() / 2).reduced (4, 0));
+        comboSpawnMode.setBounds (comboRow.reduced (4, 0));
+        area.removeFromBottom (4);
         const int knobW = area.getWidth() / 5;
         knobGrainSize.setBounds (area.removeFromLeft (knobW));
         knobDensity.setBounds (area.removeFromLeft (knobW));
@@ -185,6 +219,8 @@ void GranularProcessorAudioProcessorEditor::resized()
     // Scatter panel
     {
         auto area = scatterPanel.getContentArea();
+        comboScatterShape.setBounds (area.removeFromBottom (24).reduced (4, 0));
+        area.removeFromBottom (4);
         const int knobW = area.getWidth() / 3;
         knobPosScatter.setBounds (area.removeFromLeft (knobW));
         knobPitchScatter.setBounds (area.removeFromLeft (knobW));
@@ -197,9 +233,11 @@ void GranularProcessorAudioProcessorEditor::resized()
         const int knobW = area.getWidth() / 3;
         knobAttack.setBounds (area.removeFromLeft (knobW));
         knobDecay.setBounds (area.removeFromLeft (knobW));
-        // Shape combo in remaining space
-        auto comboArea = area.reduced (4);
-        comboEnvShape.setBounds (comboArea.withHeight (24).withCentre (comboArea.getCentre()));
+        // Curve editor in remaining space, shape combo below it
+        auto shapeArea = area.reduced (4);
+        comboEnvShape.setBounds (shapeArea.removeFromBottom (24));
+        shapeArea.removeFromBottom (4);
+        envelopeEditor.setBounds (shapeArea);
     }
 
     // Effects panel
@@ -15,6 +15,8 @@
 #include "UI/GlowToggleButton.h"
 #include "UI/PresetBar.h"
 #include "UI/ParticleVisualizer.h"
+#include "UI/EnvelopeEditor.h"
+#include "UI/PerformanceHud.h"
 #include "Utils/ParamIDs.h"
 #include "Utils/Constants.h"
 
@@ -38,8 +40,9 @@ private:
     // Top bar
     PresetBar presetBar;
 
-    // Visualizer
+    // Visualizer, with the performance overlay on top
     ParticleVisualizer visualizer;
+    PerformanceHud performanceHud;
 
     // Section panels
     SectionPanel grainPanel   { "Grain" };
@@ -56,16 +59,23 @@ private:
     CustomKnob knobPosition     { "Position", "%" };
     CustomKnob knobPitch        { "Pitch", "st" };
     CustomKnob knobPan          { "Pan" };
+    juce::ComboBox comboSpawnMode;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> spawnModeAttachment;
+    juce::ComboBox comboDensityRange;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> densityRangeAttachment;
 
     // Scatter knobs
     CustomKnob knobPosScatter   { "Pos", "%" };
     CustomKnob knobPitchScatter { "Pitch", "%" };
     CustomKnob knobPanScatter   { "Pan", "%" };
+    juce::ComboBox comboScatterShape;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> scatterShapeAttachment;
 
     // Envelope knobs
     CustomKnob knobAttack       { "Attack", "%" };
     CustomKnob knobDecay        { "Decay", "%" };
     juce::ComboBox comboEnvShape;
+    EnvelopeEditor envelopeEditor;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> envShapeAttachment;
 
     // Effects knobs
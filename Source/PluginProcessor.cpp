@@ -8,6 +8,8 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+static const juce::Identifier randomSeedID { "randomSeed" };
+
 GranularProcessorAudioProcessor::GranularProcessorAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
      : AudioProcessor (BusesProperties()
@@ -21,10 +23,59 @@ GranularProcessorAudioProcessor::GranularProcessorAudioProcessor()
        apvts (*this, nullptr, "Parameters", ParameterLayout::createLayout())
 #endif
 {
+    paramBindings.resize (static_cast<size_t> (getParameters().size()));
+
+    bindParameter (ParamIDs::grainSize,     [] (EngineParams& e, float v) { e.grainSizeMs = v; });
+    bindParameter (ParamIDs::grainDensity,  [] (EngineParams& e, float v) { e.density = v; });
+    bindParameter (ParamIDs::densityRange,  [] (EngineParams& e, float v) { e.densityScale = GranularConstants::kDensityScales[static_cast<int> (v)]; });
+    bindParameter (ParamIDs::spawnMode,     [] (EngineParams& e, float v) { e.spawnMode = static_cast<SpawnMode> (static_cast<int> (v)); });
+    bindParameter (ParamIDs::grainPosition, [] (EngineParams& e, float v) { e.position = v; });
+    bindParameter (ParamIDs::grainPitch,    [] (EngineParams& e, float v) { e.pitch = v; });
+    bindParameter (ParamIDs::grainPan,      [] (EngineParams& e, float v) { e.pan = v; });
+    bindParameter (ParamIDs::posScatter,    [] (EngineParams& e, float v) { e.posScatter = v; });
+    bindParameter (ParamIDs::pitchScatter,  [] (EngineParams& e, float v) { e.pitchScatter = v; });
+    bindParameter (ParamIDs::panScatter,    [] (EngineParams& e, float v) { e.panScatter = v; });
+    bindParameter (ParamIDs::scatterShape,  [] (EngineParams& e, float v) { e.scatterShape = static_cast<ScatterDistribution> (static_cast<int> (v)); });
+    bindParameter (ParamIDs::grainAttack,   [] (EngineParams& e, float v) { e.attack = v; });
+    bindParameter (ParamIDs::grainDecay,    [] (EngineParams& e, float v) { e.decay = v; });
+    bindParameter (ParamIDs::envelopeShape, [] (EngineParams& e, float v) { e.envShape = static_cast<EnvelopeShape> (static_cast<int> (v)); });
+    bindParameter (ParamIDs::freeze,        [] (EngineParams& e, float v) { e.freeze = v > 0.5f; });
+    bindParameter (ParamIDs::reverse,       [] (EngineParams& e, float v) { e.reverse = v > 0.5f; });
+    bindParameter (ParamIDs::feedback,      [] (EngineParams& e, float v) { e.feedback = v; });
+    bindParameter (ParamIDs::shimmer,       [] (EngineParams& e, float v) { e.shimmer = v; });
+    bindParameter (ParamIDs::lowCut,        [] (EngineParams& e, float v) { e.lowCut = v; });
+    bindParameter (ParamIDs::highCut,       [] (EngineParams& e, float v) { e.highCut = v; });
+    bindParameter (ParamIDs::lfoRate,       [] (EngineParams& e, float v) { e.lfoRate = v; });
+    bindParameter (ParamIDs::lfoDepth,      [] (EngineParams& e, float v) { e.lfoDepth = v; });
+    bindParameter (ParamIDs::lfoShape,      [] (EngineParams& e, float v) { e.lfoShape = static_cast<LFOShape> (static_cast<int> (v)); });
+    bindParameter (ParamIDs::lfoTarget,     [] (EngineParams& e, float v) { e.lfoTarget = static_cast<LFOTarget> (static_cast<int> (v)); });
+    bindParameter (ParamIDs::stereoWidth,   [] (EngineParams& e, float v) { e.stereoWidth = v; });
+    bindParameter (ParamIDs::outputLevel,   [] (EngineParams& e, float v) { e.outputLevelDb = v; });
+    bindParameter (ParamIDs::dryWet,        [] (EngineParams& e, float v) { e.dryWet = v; });
+    bindParameter (ParamIDs::bufferLength,  [] (EngineParams& e, float v) { e.bufferLengthSec = v; });
+    bindParameter (ParamIDs::interpQuality, [] (EngineParams& e, float v) { e.interpolation = static_cast<InterpolationQuality> (static_cast<int> (v)); });
+    bindParameter (ParamIDs::poolCapacity,  [] (EngineParams& e, float v) { e.poolCapacity = 64 << (2 * static_cast<int> (v)); }); // 64, 256, 1024, 4096
+    bindParameter (ParamIDs::stealPolicy,   [] (EngineParams& e, float v) { e.stealPolicy = static_cast<StealPolicy> (static_cast<int> (v)); });
+    bindParameter (ParamIDs::workerThreads, [] (EngineParams& e, float v) { e.multithreaded = v > 0.5f; });
+    bindParameter (ParamIDs::renderMode,    [] (EngineParams& e, float v) { e.pipelined = v > 0.5f; });
+    bindParameter (ParamIDs::cpuGovernor,   [] (EngineParams& e, float v) { e.adaptiveQuality = v > 0.5f; });
+
+    apvts.addParameterListener (ParamIDs::renderMode, this);
+    apvts.addParameterListener (ParamIDs::workerThreads, this);
+
+    // Each instance scatters with its own seed, saved with the state so a
+    // session renders the same grains every time it is bounced
+    const auto seed = juce::Random::getSystemRandom().nextInt64();
+    apvts.state.setProperty (randomSeedID, seed, nullptr);
+    granularEngine.setRandomSeed (static_cast<juce::uint64> (seed));
 }
 
 GranularProcessorAudioProcessor::~GranularProcessorAudioProcessor()
 {
+    apvts.removeParameterListener (ParamIDs::renderMode, this);
+    apvts.removeParameterListener (ParamIDs::workerThreads, this);
+    cancelPendingUpdate();
+    pipelinedRenderer.stop();
 }
 
 const juce::String GranularProcessorAudioProcessor::getName() const
@@ -92,11 +143,22 @@ void GranularProcessorAudioProcessor::changeProgramName (int index, const juce::
 
 void GranularProcessorAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    granularEngine.prepare (sampleRate, samplesPerBlock, getTotalNumOutputChannels());
+    // The render thread must be idle while the engine reallocates
+    pipelinedRenderer.stop();
+    granularEngine.prepare (sampleRate, samplesPerBlock, getTotalNumOutputChannels(),
+                            readEngineParams().poolCapacity);
+    pipelinedRenderer.prepare (sampleRate, samplesPerBlock, getTotalNumOutputChannels());
+
+    if (readEngineParams().multithreaded)
+        granularEngine.startWorkerThreads();
+
+    pipelineActive = readEngineParams().pipelined;
+    updateLatency();
 }
 
 void GranularProcessorAudioProcessor::releaseResources()
 {
+    pipelinedRenderer.stop();
     granularEngine.reset();
 }
 
@@ -123,6 +185,7 @@ bool GranularProcessorAudioProcessor::isBusesLayoutSupported (const BusesLayout&
 
 void GranularProcessorAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    GRANULAR_TRACE_SCOPE ("processBlock", "audio");
     juce::ScopedNoDenormals noDenormals;
     juce::ignoreUnused (midiMessages);
 
@@ -132,7 +195,75 @@ void GranularProcessorAudioProcessor::processBlock (juce::AudioBuffer<float>& bu
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    granularEngine.process (buffer, apvts);
+    // Parameters apply from the start of the block. JUCE's plugin wrappers hand
+    // over only the last value of each VST3 parameter queue, not its sample
+    // offsets, so changes inside a block can't be placed more precisely here;
+    // the engine smooths position and the other control-rate parameters instead.
+    renderEngine (buffer, readEngineParams());
+}
+
+void GranularProcessorAudioProcessor::renderEngine (juce::AudioBuffer<float>& buffer, const EngineParams& params)
+{
+    // Switching modes drops the block in flight; the pipeline restarts from silence
+    if (params.pipelined != pipelineActive)
+    {
+        pipelinedRenderer.reset();
+        pipelineActive = params.pipelined;
+    }
+
+    if (pipelineActive)
+        pipelinedRenderer.process (buffer, params);
+    else
+        granularEngine.process (buffer, params);
+}
+
+void GranularProcessorAudioProcessor::updateLatency()
+{
+    const bool pipelined = apvts.getRawParameterValue (ParamIDs::renderMode)->load() > 0.5f;
+    setLatencySamples (pipelined ? pipelinedRenderer.getLatencySamples() : 0);
+}
+
+void GranularProcessorAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    if (parameterID == ParamIDs::workerThreads)
+    {
+        // This can arrive on the audio thread, so the threads start on the message thread
+        if (newValue > 0.5f)
+            triggerAsyncUpdate();
+
+        return;
+    }
+
+    updateLatency();
+}
+
+void GranularProcessorAudioProcessor::handleAsyncUpdate()
+{
+    granularEngine.startWorkerThreads();
+}
+
+void GranularProcessorAudioProcessor::bindParameter (const juce::String& paramID, ParamApplier apply)
+{
+    auto* parameter = apvts.getParameter (paramID);
+    jassert (parameter != nullptr);
+
+    auto& binding = paramBindings[static_cast<size_t> (parameter->getParameterIndex())];
+    binding.rawValue = apvts.getRawParameterValue (paramID);
+    binding.apply = apply;
+}
+
+EngineParams GranularProcessorAudioProcessor::readEngineParams() const
+{
+    EngineParams params;
+
+    for (const auto& binding : paramBindings)
+        if (binding.apply != nullptr)
+            binding.apply (params, binding.rawValue->load());
+
+    // Offline renders have no deadline, so they always get full quality
+    params.adaptiveQuality = params.adaptiveQuality && ! isNonRealtime();
+
+    return params;
 }
 
 bool GranularProcessorAudioProcessor::hasEditor() const
@@ -156,7 +287,40 @@ void GranularProcessorAudioProcessor::setStateInformation (const void* data, int
 {
     std::unique_ptr<juce::XmlElement> xml (getXmlFromBinary (data, sizeInBytes));
     if (xml != nullptr && xml->hasTagName (apvts.state.getType()))
+    {
         apvts.replaceState (juce::ValueTree::fromXml (*xml));
+        granularEngine.setCustomEnvelope (getCustomEnvelope());
+
+        // Sessions saved before seeds were stored keep this instance's seed
+        if (apvts.state.hasProperty (randomSeedID))
+            granularEngine.setRandomSeed (static_cast<juce::uint64> (static_cast<juce::int64> (apvts.state.getProperty (randomSeedID))));
+        else
+            apvts.state.setProperty (randomSeedID, static_cast<juce::int64> (granularEngine.getRandomSeed()), nullptr);
+    }
+}
+
+static const juce::Identifier customEnvelopeID { "customEnvelope" };
+
+void GranularProcessorAudioProcessor::setCustomEnvelope (const GrainEnvelope::CustomPoints& points)
+{
+    juce::StringArray values;
+    for (auto v : points)
+        values.add (juce::String (v, 4));
+
+    apvts.state.setProperty (customEnvelopeID, values.joinIntoString (","), nullptr);
+    granularEngine.setCustomEnvelope (points);
+}
+
+GrainEnvelope::CustomPoints GranularProcessorAudioProcessor::getCustomEnvelope() const
+{
+    auto points = GrainEnvelope::makeCustomPoints (EnvelopeShape::Hanning);
+
+    const auto values = juce::StringArray::fromTokens (apvts.state.getProperty (customEnvelopeID).toString(), ",", {});
+    if (values.size() == static_cast<int> (points.size()))
+        for (size_t i = 0; i < points.size(); ++i)
+            points[i] = juce::jlimit (0.0f, 1.0f, values[static_cast<int> (i)].getFloatValue());
+
+    return points;
 }
 
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -9,9 +9,14 @@
 
 #include <JuceHeader.h>
 #include "DSP/GranularEngine.h"
+#include "DSP/PipelinedRenderer.h"
 #include "Utils/ParameterLayout.h"
+#include "Utils/ParamIDs.h"
+#include <vector>
 
-class GranularProcessorAudioProcessor : public juce::AudioProcessor
+class GranularProcessorAudioProcessor : public juce::AudioProcessor,
+                                        private juce::AudioProcessorValueTreeState::Listener,
+                                        private juce::AsyncUpdater
 {
 public:
     GranularProcessorAudioProcessor();
@@ -48,9 +53,42 @@ public:
     juce::AudioProcessorValueTreeState& getAPVTS() { return apvts; }
     GranularEngine& getGranularEngine() { return granularEngine; }
 
+    /** The user-drawn envelope curve, stored with the plugin state. */
+    void setCustomEnvelope (const GrainEnvelope::CustomPoints& points);
+    GrainEnvelope::CustomPoints getCustomEnvelope() const;
+
 private:
+    /** Copies one parameter's plain value into the engine snapshot. */
+    using ParamApplier = void (*) (EngineParams&, float);
+
+    /** Each parameter, by parameter index, with its value source, looked up once
+        in the constructor so the audio thread never searches parameters by ID. */
+    struct ParameterBinding
+    {
+        std::atomic<float>* rawValue = nullptr;
+        ParamApplier apply = nullptr;
+    };
+
+    void bindParameter (const juce::String& paramID, ParamApplier apply);
+
+    /** Snapshot the bound parameter values for one block. */
+    EngineParams readEngineParams() const;
+
+    /** Run the engine on one block, directly or through the pipeline. */
+    void renderEngine (juce::AudioBuffer<float>& buffer, const EngineParams& params);
+
+    /** Report the pipeline's latency to the host while pipelined rendering is selected. */
+    void updateLatency();
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+
+    /** Start the engine's worker threads once Worker Threads is switched on. */
+    void handleAsyncUpdate() override;
+
     juce::AudioProcessorValueTreeState apvts;
+    std::vector<ParameterBinding> paramBindings;
     GranularEngine granularEngine;
+    PipelinedRenderer pipelinedRenderer { granularEngine };
+    bool pipelineActive = false;   // audio thread: the renderer owns the engine
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GranularProcessorAudioProcessor)
 };
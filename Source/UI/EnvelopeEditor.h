@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+    EnvelopeEditor.h
+    Shows the curve of the selected envelope shape and lets the user draw a
+    custom one. Drawing on a built-in shape starts from that shape's curve and
+    switches the Env Shape parameter to Custom.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "../DSP/GrainEnvelope.h"
+#include "../Utils/ParamIDs.h"
+#include "CustomLookAndFeel.h"
+#include <functional>
+
+class EnvelopeEditor : public juce::Component
+{
+public:
+    explicit EnvelopeEditor (juce::AudioProcessorValueTreeState& apvts)
+        : shapeAttachment (*apvts.getParameter (ParamIDs::envelopeShape),
+                           [this] (float value) { currentShape = static_cast<EnvelopeShape> (juce::roundToInt (value)); repaint(); },
+                           nullptr)
+    {
+        shapeAttachment.sendInitialUpdate();
+    }
+
+    /** Called whenever the user changes the drawn curve. */
+    std::function<void (const GrainEnvelope::CustomPoints&)> onCustomPointsChanged;
+
+    /** Set the drawn curve without notifying (e.g. when the editor opens). */
+    void setCustomPoints (const GrainEnvelope::CustomPoints& points)
+    {
+        customPoints = points;
+        repaint();
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto bounds = getLocalBounds().toFloat().reduced (1.0f);
+
+        g.setColour (Theme::knobBackground);
+        g.fillRoundedRectangle (bounds, 4.0f);
+        g.setColour (Theme::panelBorder.withAlpha (0.5f));
+        g.drawRoundedRectangle (bounds, 4.0f, 1.0f);
+
+        const auto plot = getPlotArea();
+        const bool custom = currentShape == EnvelopeShape::Custom;
+        const int numPoints = static_cast<int> (customPoints.size());
+
+        juce::Path curve;
+        for (int i = 0; i < numPoints; ++i)
+        {
+            const float u = static_cast<float> (i) / static_cast<float> (numPoints - 1);
+            const float y = custom ? customPoints[static_cast<size_t> (i)]
+                                   : GrainEnvelope::evaluateShape (currentShape, u);
+            const juce::Point<float> p { plot.getX() + u * plot.getWidth(), plot.getBottom() - y * plot.getHeight() };
+
+            if (i == 0)
+                curve.startNewSubPath (p);
+            else
+                curve.lineTo (p);
+        }
+
+        const auto colour = custom ? Theme::accentPink : Theme::primaryCyan;
+
+        juce::Path fill (curve);
+        fill.lineTo (plot.getBottomRight());
+        fill.lineTo (plot.getBottomLeft());
+        fill.closeSubPath();
+        g.setColour (colour.withAlpha (0.12f));
+        g.fillPath (fill);
+
+        g.setColour (colour.withAlpha (custom ? 0.9f : 0.6f));
+        g.strokePath (curve, juce::PathStrokeType (1.5f));
+    }
+
+    void mouseDown (const juce::MouseEvent& e) override
+    {
+        // Start from the shape being shown, so drawing edits what the user sees
+        if (currentShape != EnvelopeShape::Custom)
+        {
+            customPoints = GrainEnvelope::makeCustomPoints (currentShape);
+            shapeAttachment.setValueAsCompleteGesture (static_cast<float> (EnvelopeShape::Custom));
+        }
+
+        lastDrawPoint = e.position;
+        drawTo (e.position);
+    }
+
+    void mouseDrag (const juce::MouseEvent& e) override
+    {
+        drawTo (e.position);
+    }
+
+private:
+    juce::Rectangle<float> getPlotArea() const
+    {
+        return getLocalBounds().toFloat().reduced (4.0f);
+    }
+
+    /** Set every control point between the previous and the current mouse position,
+        so fast strokes don't leave gaps. */
+    void drawTo (juce::Point<float> pos)
+    {
+        const auto plot = getPlotArea();
+        const int lastPoint = static_cast<int> (customPoints.size()) - 1;
+
+        auto toIndex = [&] (float x) { return (x - plot.getX()) / plot.getWidth() * static_cast<float> (lastPoint); };
+        auto toValue = [&] (float y) { return juce::jlimit (0.0f, 1.0f, (plot.getBottom() - y) / plot.getHeight()); };
+
+        const float x0 = toIndex (lastDrawPoint.x), y0 = toValue (lastDrawPoint.y);
+        const float x1 = toIndex (pos.x),           y1 = toValue (pos.y);
+
+        const int first = juce::jlimit (0, lastPoint, juce::roundToInt (juce::jmin (x0, x1)));
+        const int last  = juce::jlimit (0, lastPoint, juce::roundToInt (juce::jmax (x0, x1)));
+
+        for (int i = first; i <= last; ++i)
+        {
+            const float t = std::abs (x1 - x0) > 1.0e-3f ? juce::jlimit (0.0f, 1.0f, (static_cast<float> (i) - x0) / (x1 - x0)) : 1.0f;
+            customPoints[static_cast<size_t> (i)] = y0 + t * (y1 - y0);
+        }
+
+        lastDrawPoint = pos;
+        repaint();
+
+        if (onCustomPointsChanged)
+            onCustomPointsChanged (customPoints);
+    }
+
+    juce::ParameterAttachment shapeAttachment;
+    EnvelopeShape currentShape = EnvelopeShape::Hanning;
+    GrainEnvelope::CustomPoints customPoints = GrainEnvelope::makeCustomPoints (EnvelopeShape::Hanning);
+    juce::Point<float> lastDrawPoint;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EnvelopeEditor)
+};
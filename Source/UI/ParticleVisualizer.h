@@ -13,6 +13,7 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "../DSP/GranularEngine.h"
 #include "CustomLookAndFeel.h"
+#include "../Utils/TraceRecorder.h"
 #include <array>
 #include <cmath>
 
@@ -54,9 +55,14 @@ public:
         openGLContext.detach();
     }
 
+    /** Take a copy of the live grains in data (called from the message thread). */
     void updateGrainData (const GrainVisualData& data)
     {
-        latestData.store (data);
+        currentData.activeCount = data.activeCount;
+        currentData.capacity    = data.capacity;
+        currentData.inputLevel  = data.inputLevel;
+        currentData.outputLevel = data.outputLevel;
+        std::copy (data.grains.begin(), data.grains.begin() + data.activeCount, currentData.grains.begin());
     }
 
     // OpenGLRenderer callbacks
@@ -65,6 +71,8 @@ public:
 
     void renderOpenGL() override
     {
+        GRANULAR_TRACE_SCOPE ("Visualizer frame", "ui");
+
         juce::OpenGLHelpers::clear (Theme::background);
 
         const float w = static_cast<float> (getWidth());
@@ -108,54 +116,59 @@ private:
         float pan          = 0.0f;
         float grainSize    = 0.0f;
         bool  wasActive    = false;
+        juce::uint32 lastSeenTick = 0;  // last timer tick the grain was in the snapshot
     };
 
     void timerCallback() override
     {
-        currentData = latestData.load();
+        GRANULAR_TRACE_SCOPE ("Visualizer update", "ui");
 
         // Advance global time (~22ms per tick at 45 Hz)
         const float dt = 1.0f / 45.0f;
         globalTime += dt;
+        ++tick;
 
-        // Smooth each visual particle towards its grain data
-        for (int i = 0; i < GranularConstants::kMaxGrains; ++i)
+        // Smooth the particle of each live grain towards its grain data
+        for (int k = 0; k < currentData.activeCount; ++k)
         {
+            const auto& gi = currentData.grains[static_cast<size_t> (k)];
+            const int i = gi.slot;
             auto& vp = particles[static_cast<size_t> (i)];
-            const auto& gi = currentData.grains[static_cast<size_t> (i)];
+            vp.lastSeenTick = tick;
+
+            // Map grain data to visual position
+            // X: use grain's normalised position but as a STABLE scatter coordinate
+            //    (avoid left-to-right sweep by using a hash-like mapping)
+            const float stableX = hashPosition (gi.normPosition, static_cast<float> (i));
+            // Y: pitch maps to vertical, with some envelope breathing
+            const float stableY = 0.5f - gi.pitch / 48.0f;
+
+            // Smooth towards target (exponential interpolation)
+            const float posSmooth = ! vp.wasActive ? 0.6f : 0.08f; // snap faster on spawn
+            vp.baseX = vp.wasActive ? lerp (vp.baseX, stableX, posSmooth) : stableX;
+            vp.baseY = vp.wasActive ? lerp (vp.baseY, stableY, posSmooth) : stableY;
+            vp.envelope = gi.envelope;
+            vp.pitch    = gi.pitch;
+            vp.pan      = gi.pan;
+            vp.grainSize = gi.size;
+
+            // Fade IN — gentle
+            const float targetAlpha = gi.envelope;
+            vp.displayAlpha = lerp (vp.displayAlpha, targetAlpha, 0.15f);
+
+            const float targetSize = 2.0f + gi.size * 6.0f;
+            vp.displaySize = lerp (vp.displaySize, targetSize, 0.12f);
+
+            vp.wasActive = true;
+        }
 
+        for (auto& vp : particles)
+        {
             // Advance drift phases
             vp.driftPhaseX += vp.driftSpeedX * dt;
             vp.driftPhaseY += vp.driftSpeedY * dt;
 
-            if (gi.active)
-            {
-                // Map grain data to visual position
-                // X: use grain's normalised position but as a STABLE scatter coordinate
-                //    (avoid left-to-right sweep by using a hash-like mapping)
-                const float stableX = hashPosition (gi.normPosition, static_cast<float> (i));
-                // Y: pitch maps to vertical, with some envelope breathing
-                const float stableY = 0.5f - gi.pitch / 48.0f;
-
-                // Smooth towards target (exponential interpolation)
-                const float posSmooth = gi.active && !vp.wasActive ? 0.6f : 0.08f; // snap faster on spawn
-                vp.baseX = vp.wasActive ? lerp (vp.baseX, stableX, posSmooth) : stableX;
-                vp.baseY = vp.wasActive ? lerp (vp.baseY, stableY, posSmooth) : stableY;
-                vp.envelope = gi.envelope;
-                vp.pitch    = gi.pitch;
-                vp.pan      = gi.pan;
-                vp.grainSize = gi.size;
-
-                // Fade IN — gentle
-                const float targetAlpha = gi.envelope;
-                vp.displayAlpha = lerp (vp.displayAlpha, targetAlpha, 0.15f);
-
-                const float targetSize = 2.0f + gi.size * 6.0f;
-                vp.displaySize = lerp (vp.displaySize, targetSize, 0.12f);
-
-                vp.wasActive = true;
-            }
-            else
+            if (vp.lastSeenTick != tick && (vp.wasActive || vp.displayAlpha > 0.0f))
             {
                 // Fade OUT — slow and smooth (never abruptly disappear)
                 vp.displayAlpha *= 0.92f;  // exponential decay over ~0.5s
@@ -200,9 +213,8 @@ private:
         drawAmbientGlow (g, areaX, areaY, areaW, areaH);
 
         // ── Draw all visual particles ──
-        for (int i = 0; i < GranularConstants::kMaxGrains; ++i)
+        for (const auto& vp : particles)
         {
-            const auto& vp = particles[static_cast<size_t> (i)];
             if (vp.displayAlpha < 0.005f) continue;
 
             // Compute final position with gentle sinusoidal drift
@@ -267,9 +279,8 @@ private:
         float cx = 0.0f, cy = 0.0f;
         int count = 0;
 
-        for (int i = 0; i < GranularConstants::kMaxGrains; ++i)
+        for (const auto& vp : particles)
         {
-            const auto& vp = particles[static_cast<size_t> (i)];
             if (vp.displayAlpha < 0.02f) continue;
             cx += vp.baseX;
             cy += vp.baseY;
@@ -286,7 +297,7 @@ private:
 
         // Intensity based on active grain count (more grains = slightly brighter ambient)
         const float intensity = juce::jlimit (0.0f, 0.08f,
-            static_cast<float> (count) / static_cast<float> (GranularConstants::kMaxGrains) * 0.12f);
+            static_cast<float> (count) / static_cast<float> (juce::jmax (1, currentData.capacity)) * 0.12f);
 
         juce::ColourGradient ambientGrad (
             Theme::primaryCyan.withAlpha (intensity), gx, gy,
@@ -374,11 +385,12 @@ private:
     static float lerp (float a, float b, float t) { return a + (b - a) * t; }
 
     juce::OpenGLContext openGLContext;
-    std::atomic<GrainVisualData> latestData;
     GrainVisualData currentData;
 
-    std::array<VisualParticle, GranularConstants::kMaxGrains> particles;
+    // One particle per pool slot, so a grain keeps its particle while it lives
+    std::array<VisualParticle, GrainPool::kMaxCapacity> particles;
     float globalTime = 0.0f;
+    juce::uint32 tick = 0;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParticleVisualizer)
 };
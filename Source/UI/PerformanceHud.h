@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+    PerformanceHud.h
+    Overlay showing the engine's EngineStats: time per stage against the block
+    deadline, the process() time histogram, and grain pool activity.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "../DSP/EngineStats.h"
+#include "CustomLookAndFeel.h"
+#include <cmath>
+
+class PerformanceHud : public juce::Component
+{
+public:
+    PerformanceHud()
+    {
+        setInterceptsMouseClicks (false, false);
+    }
+
+    /** Take a copy of the latest stats (called from the message thread). */
+    void updateStats (const EngineStats& newStats)
+    {
+        stats = newStats;
+        repaint();
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto bounds = getLocalBounds().toFloat();
+        g.setColour (Theme::background.withAlpha (0.85f));
+        g.fillRoundedRectangle (bounds, 6.0f);
+        g.setColour (Theme::panelBorder);
+        g.drawRoundedRectangle (bounds.reduced (0.5f), 6.0f, 1.0f);
+
+        auto area = getLocalBounds().reduced (10, 6);
+        g.setFont (juce::FontOptions (10.0f));
+
+        const double deadline = juce::jmax (1.0, stats.deadlineMicros);
+
+        drawRow (g, area.removeFromTop (kRowHeight), "Block", stats.blockMicros, deadline, Theme::primaryCyan);
+        area.removeFromTop (4);
+
+        for (int s = 0; s < EngineStats::kNumStages; ++s)
+            drawRow (g, area.removeFromTop (kRowHeight), EngineStats::getStageName (s),
+                     stats.stageMicros[static_cast<size_t> (s)], deadline, Theme::primaryPurple);
+
+        area.removeFromTop (4);
+        drawHistogram (g, area.removeFromTop (36));
+        area.removeFromTop (4);
+
+        g.setColour (Theme::textPrimary);
+        g.drawText ("Grains " + juce::String (stats.activeGrains) + " / " + juce::String (stats.poolCapacity)
+                        + "   peak " + juce::String (stats.peakActiveGrains),
+                    area.removeFromTop (kRowHeight), juce::Justification::centredLeft);
+        g.drawText ("Spawns " + juce::String (stats.spawns) + "   steals " + juce::String (stats.steals)
+                        + "   pool full " + juce::String (stats.exhausted),
+                    area.removeFromTop (kRowHeight), juce::Justification::centredLeft);
+
+        g.setColour (stats.governorLevel > 0 ? Theme::accentPink : Theme::textSecondary);
+        g.drawText ("Peak load " + juce::String (stats.peakLoad * 100.0, 0) + "%   governor level "
+                        + juce::String (stats.governorLevel),
+                    area.removeFromTop (kRowHeight), juce::Justification::centredLeft);
+    }
+
+private:
+    static constexpr int kRowHeight = 12;
+    static constexpr int kLabelWidth = 80;
+    static constexpr int kValueWidth = 90;
+
+    /** Label, a bar of micros as a share of the deadline, and the value. */
+    void drawRow (juce::Graphics& g, juce::Rectangle<int> row, const juce::String& label,
+                  double micros, double deadline, juce::Colour colour)
+    {
+        g.setColour (Theme::textSecondary);
+        g.drawText (label, row.removeFromLeft (kLabelWidth), juce::Justification::centredLeft);
+
+        g.setColour (Theme::textPrimary);
+        g.drawText (juce::String (micros, 1) + " us  " + juce::String (100.0 * micros / deadline, 1) + "%",
+                    row.removeFromRight (kValueWidth), juce::Justification::centredRight);
+
+        auto bar = row.reduced (4, 4).toFloat();
+        g.setColour (Theme::knobTrack);
+        g.fillRect (bar);
+        g.setColour (micros > deadline ? Theme::accentPink : colour);
+        g.fillRect (bar.withWidth (bar.getWidth() * static_cast<float> (juce::jmin (1.0, micros / deadline))));
+    }
+
+    /** Blocks per 10% load bin, scaled to the fullest bin; the overrun bin in pink. */
+    void drawHistogram (juce::Graphics& g, juce::Rectangle<int> area)
+    {
+        g.setColour (Theme::textSecondary);
+        g.drawText ("Load", area.removeFromLeft (kLabelWidth), juce::Justification::topLeft);
+
+        juce::uint32 fullest = 1;
+        for (auto count : stats.loadHistogram)
+            fullest = juce::jmax (fullest, count);
+
+        const float binWidth = static_cast<float> (area.getWidth()) / EngineStats::kNumLoadBins;
+        const auto bottom = static_cast<float> (area.getBottom());
+
+        for (int b = 0; b < EngineStats::kNumLoadBins; ++b)
+        {
+            const auto count = stats.loadHistogram[static_cast<size_t> (b)];
+            if (count == 0)
+                continue;
+
+            // Square-root scale keeps rare slow blocks visible next to the common case
+            const float height = static_cast<float> (area.getHeight())
+                                   * std::sqrt (static_cast<float> (count) / static_cast<float> (fullest));
+
+            g.setColour (b == EngineStats::kNumLoadBins - 1 ? Theme::accentPink : Theme::accentGreen);
+            g.fillRect (static_cast<float> (area.getX()) + static_cast<float> (b) * binWidth + 1.0f, bottom - height,
+                        binWidth - 2.0f, height);
+        }
+    }
+
+    EngineStats stats;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PerformanceHud)
+};
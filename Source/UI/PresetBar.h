@@ -11,7 +11,9 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "CustomLookAndFeel.h"
 #include "../Utils/ParamIDs.h"
+#include "../Utils/TraceRecorder.h"
 
+#include <functional>
 #include <map>
 #include <vector>
 
@@ -57,20 +59,45 @@ public:
         saveButton.onClick = [this]() { savePreset(); };
         addAndMakeVisible (saveButton);
 
+        // Engine settings menu
+        engineButton.setButtonText ("Engine");
+        engineButton.onClick = [this]() { showEngineMenu(); };
+        addAndMakeVisible (engineButton);
+
+        // Performance overlay toggle
+        perfButton.setButtonText ("Perf");
+        perfButton.setClickingTogglesState (true);
+        perfButton.onClick = [this]()
+        {
+            if (onPerformanceHudToggled)
+                onPerformanceHudToggled (perfButton.getToggleState());
+        };
+        addAndMakeVisible (perfButton);
+
         // Style buttons
-        for (auto* btn : { &prevButton, &nextButton, &saveButton })
+        for (auto* btn : { &prevButton, &nextButton, &saveButton, &engineButton, &perfButton })
         {
             btn->setColour (juce::TextButton::buttonColourId, Theme::panelBackground);
             btn->setColour (juce::TextButton::textColourOffId, Theme::textSecondary);
         }
+
+        perfButton.setColour (juce::TextButton::buttonOnColourId, Theme::panelBorder);
+        perfButton.setColour (juce::TextButton::textColourOnId, Theme::primaryCyan);
     }
 
+    /** Called with the new state when the performance overlay is switched on or off. */
+    std::function<void (bool)> onPerformanceHudToggled;
+
     void resized() override
     {
         auto bounds = getLocalBounds().reduced (8, 4);
 
         titleLabel.setBounds (bounds.removeFromLeft (120));
 
+        perfButton.setBounds (bounds.removeFromRight (50));
+        bounds.removeFromRight (4);
+        engineButton.setBounds (bounds.removeFromRight (70));
+        bounds.removeFromRight (4);
         saveButton.setBounds (bounds.removeFromRight (60));
         bounds.removeFromRight (4);
         nextButton.setBounds (bounds.removeFromRight (30));
@@ -99,6 +126,72 @@ private:
         std::map<juce::String, float> values;
     };
 
+    /** Add one ticked item per choice of a choice parameter to menu. */
+    void addChoiceItems (juce::PopupMenu& menu, const juce::String& paramID)
+    {
+        auto* param = dynamic_cast<juce::AudioParameterChoice*> (valueTreeState.getParameter (paramID));
+        if (param == nullptr)
+            return;
+
+        for (int i = 0; i < param->choices.size(); ++i)
+        {
+            menu.addItem (param->choices[i], true, param->getIndex() == i, [param, i]()
+            {
+                param->beginChangeGesture();
+                param->setValueNotifyingHost (param->convertTo0to1 (static_cast<float> (i)));
+                param->endChangeGesture();
+            });
+        }
+    }
+
+    /** Settings that trade CPU for quality and are not part of presets. */
+    void showEngineMenu()
+    {
+        juce::PopupMenu interpolationMenu;
+        addChoiceItems (interpolationMenu, ParamIDs::interpQuality);
+
+        juce::PopupMenu poolMenu;
+        addChoiceItems (poolMenu, ParamIDs::poolCapacity);
+
+        juce::PopupMenu stealMenu;
+        addChoiceItems (stealMenu, ParamIDs::stealPolicy);
+
+        juce::PopupMenu threadMenu;
+        addChoiceItems (threadMenu, ParamIDs::workerThreads);
+
+        juce::PopupMenu renderMenu;
+        addChoiceItems (renderMenu, ParamIDs::renderMode);
+
+        juce::PopupMenu governorMenu;
+        addChoiceItems (governorMenu, ParamIDs::cpuGovernor);
+
+        juce::PopupMenu menu;
+        menu.addSubMenu ("Interpolation", interpolationMenu);
+        menu.addSubMenu ("Grain Pool", poolMenu);
+        menu.addSubMenu ("Grain Stealing", stealMenu);
+        menu.addSubMenu ("Worker Threads", threadMenu);
+        menu.addSubMenu ("Render Mode", renderMenu);
+        menu.addSubMenu ("CPU Governor", governorMenu);
+
+        auto& tracer = TraceRecorder::getInstance();
+        menu.addSeparator();
+        menu.addItem ("Record Trace", true, tracer.isRecording(), [&tracer]()
+        {
+            if (tracer.isRecording())
+            {
+                tracer.stop();
+                tracer.getTraceFile().revealToUser();
+            }
+            else if (! tracer.start (TraceRecorder::getDefaultTraceFile()))
+            {
+                juce::AlertWindow::showMessageBoxAsync (juce::MessageBoxIconType::WarningIcon,
+                                                        "Record Trace", "Could not create the trace file.");
+            }
+        });
+
+        menu.showMenuAsync (juce::PopupMenu::Options().withTargetComponent (&engineButton));
+    }
+
     void loadSelectedPreset()
     {
         const int idx = presetCombo.getSelectedId() - 1;
@@ -129,12 +222,15 @@ private:
         presets.push_back ({ "Init", {
             { ParamIDs::grainSize,     100.0f },
             { ParamIDs::grainDensity,  8.0f },
+            { ParamIDs::densityRange,  0.0f },
+            { ParamIDs::spawnMode,     0.0f },
             { ParamIDs::grainPosition, 50.0f },
             { ParamIDs::grainPitch,    0.0f },
             { ParamIDs::grainPan,      0.0f },
             { ParamIDs::posScatter,    20.0f },
             { ParamIDs::pitchScatter,  0.0f },
             { ParamIDs::panScatter,    30.0f },
+            { ParamIDs::scatterShape,  0.0f },
             { ParamIDs::grainAttack,   25.0f },
             { ParamIDs::grainDecay,    25.0f },
             { ParamIDs::envelopeShape, 0.0f },
@@ -158,12 +254,15 @@ private:
         presets.push_back ({ "Ambient Pad", {
             { ParamIDs::grainSize,     250.0f },
             { ParamIDs::grainDensity,  12.0f },
+            { ParamIDs::densityRange,  0.0f },
+            { ParamIDs::spawnMode,     0.0f },
             { ParamIDs::grainPosition, 50.0f },
             { ParamIDs::grainPitch,    0.0f },
             { ParamIDs::grainPan,      0.0f },
             { ParamIDs::posScatter,    40.0f },
             { ParamIDs::pitchScatter,  5.0f },
             { ParamIDs::panScatter,    60.0f },
+            { ParamIDs::scatterShape,  0.0f },
             { ParamIDs::grainAttack,   40.0f },
             { ParamIDs::grainDecay,    40.0f },
             { ParamIDs::envelopeShape, 0.0f },
@@ -187,12 +286,15 @@ private:
         presets.push_back ({ "Frozen Texture", {
             { ParamIDs::grainSize,     300.0f },
             { ParamIDs::grainDensity,  15.0f },
+            { ParamIDs::densityRange,  0.0f },
+            { ParamIDs::spawnMode,     0.0f },
             { ParamIDs::grainPosition, 50.0f },
             { ParamIDs::grainPitch,    0.0f },
             { ParamIDs::grainPan,      0.0f },
             { ParamIDs::posScatter,    60.0f },
             { ParamIDs::pitchScatter,  8.0f },
             { ParamIDs::panScatter,    80.0f },
+            { ParamIDs::scatterShape,  0.0f },
             { ParamIDs::grainAttack,   35.0f },
             { ParamIDs::grainDecay,    35.0f },
             { ParamIDs::envelopeShape, 1.0f },
@@ -216,12 +318,15 @@ private:
         presets.push_back ({ "Shimmer Cloud", {
             { ParamIDs::grainSize,     200.0f },
             { ParamIDs::grainDensity,  10.0f },
+            { ParamIDs::densityRange,  0.0f },
+            { ParamIDs::spawnMode,     0.0f },
             { ParamIDs::grainPosition, 50.0f },
             { ParamIDs::grainPitch,    12.0f },
             { ParamIDs::grainPan,      0.0f },
             { ParamIDs::posScatter,    35.0f },
             { ParamIDs::pitchScatter,  10.0f },
             { ParamIDs::panScatter,    70.0f },
+            { ParamIDs::scatterShape,  0.0f },
             { ParamIDs::grainAttack,   30.0f },
             { ParamIDs::grainDecay,    45.0f },
             { ParamIDs::envelopeShape, 0.0f },
@@ -245,12 +350,15 @@ private:
         presets.push_back ({ "Glitch Scatter", {
             { ParamIDs::grainSize,     30.0f },
             { ParamIDs::grainDensity,  35.0f },
+            { ParamIDs::densityRange,  0.0f },
+            { ParamIDs::spawnMode,     0.0f },
             { ParamIDs::grainPosition, 50.0f },
             { ParamIDs::grainPitch,    0.0f },
             { ParamIDs::grainPan,      0.0f },
             { ParamIDs::posScatter,    90.0f },
             { ParamIDs::pitchScatter,  60.0f },
             { ParamIDs::panScatter,    100.0f },
+            { ParamIDs::scatterShape,  0.0f },
             { ParamIDs::grainAttack,   5.0f },
             { ParamIDs::grainDecay,    10.0f },
             { ParamIDs::envelopeShape, 3.0f },
@@ -274,12 +382,15 @@ private:
         presets.push_back ({ "Dark Drone", {
             { ParamIDs::grainSize,     400.0f },
             { ParamIDs::grainDensity,  5.0f },
+            { ParamIDs::densityRange,  0.0f },
+            { ParamIDs::spawnMode,     0.0f },
             { ParamIDs::grainPosition, 50.0f },
             { ParamIDs::grainPitch,    -12.0f },
             { ParamIDs::grainPan,      0.0f },
             { ParamIDs::posScatter,    25.0f },
             { ParamIDs::pitchScatter,  3.0f },
             { ParamIDs::panScatter,    40.0f },
+            { ParamIDs::scatterShape,  0.0f },
             { ParamIDs::grainAttack,   45.0f },
             { ParamIDs::grainDecay,    45.0f },
             { ParamIDs::envelopeShape, 1.0f },
@@ -303,12 +414,15 @@ private:
         presets.push_back ({ "Crystal Rain", {
             { ParamIDs::grainSize,     50.0f },
             { ParamIDs::grainDensity,  25.0f },
+            { ParamIDs::densityRange,  0.0f },
+            { ParamIDs::spawnMode,     0.0f },
             { ParamIDs::grainPosition, 50.0f },
             { ParamIDs::grainPitch,    7.0f },
             { ParamIDs::grainPan,      0.0f },
             { ParamIDs::posScatter,    70.0f },
             { ParamIDs::pitchScatter,  20.0f },
             { ParamIDs::panScatter,    90.0f },
+            { ParamIDs::scatterShape,  0.0f },
             { ParamIDs::grainAttack,   10.0f },
             { ParamIDs::grainDecay,    30.0f },
             { ParamIDs::envelopeShape, 2.0f },
@@ -332,12 +446,15 @@ private:
         presets.push_back ({ "Reverse Wash", {
             { ParamIDs::grainSize,     350.0f },
             { ParamIDs::grainDensity,  8.0f },
+            { ParamIDs::densityRange,  0.0f },
+            { ParamIDs::spawnMode,     0.0f },
             { ParamIDs::grainPosition, 50.0f },
             { ParamIDs::grainPitch,    0.0f },
             { ParamIDs::grainPan,      0.0f },
             { ParamIDs::posScatter,    50.0f },
             { ParamIDs::pitchScatter,  5.0f },
             { ParamIDs::panScatter,    55.0f },
+            { ParamIDs::scatterShape,  0.0f },
             { ParamIDs::grainAttack,   10.0f },
             { ParamIDs::grainDecay,    50.0f },
             { ParamIDs::envelopeShape, 0.0f },
@@ -366,6 +483,8 @@ private:
     juce::TextButton prevButton;
     juce::TextButton nextButton;
     juce::TextButton saveButton;
+    juce::TextButton engineButton;
+    juce::TextButton perfButton;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetBar)
 };
@@ -9,8 +9,15 @@
 
 namespace GranularConstants
 {
-    // Grain pool
-    constexpr int    kMaxGrains         = 64;
+    // Grain pool: storage for kMaxGrains is preallocated, the usable capacity is an engine setting
+    constexpr int    kMaxGrains         = 4096;
+    constexpr int    kDefaultPoolCapacity = 256;
+
+    // Multithreaded rendering starts above this many active grains x block samples
+    constexpr int    kParallelRenderThreshold = 32768;
+
+    // Envelope
+    constexpr int    kCustomEnvelopePoints = 32;
 
     // Circular buffer
     constexpr float  kMinBufferSeconds  = 1.0f;
@@ -27,6 +34,9 @@ namespace GranularConstants
     constexpr float  kMaxDensity        = 50.0f;
     constexpr float  kDefaultDensity    = 8.0f;
 
+    // Density Range multipliers; x40 reaches 2000 grains per second
+    constexpr float  kDensityScales[]   = { 1.0f, 10.0f, 40.0f };
+
     // Pitch (semitones)
     constexpr float  kMinPitch          = -24.0f;
     constexpr float  kMaxPitch          = 24.0f;
@@ -56,4 +66,8 @@ namespace GranularConstants
 
     // Smoothing ramp length (samples)
     constexpr int    kSmoothingRampLen  = 64;
+
+    // Control rate: LFO, scheduling and parameter smoothing advance once per sub-block
+    constexpr int    kControlBlockSize  = 32;
+    constexpr double kParamSmoothingSec = 0.05;
 }
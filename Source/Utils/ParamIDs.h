@@ -14,6 +14,8 @@ namespace ParamIDs
     // Core Grain
     inline const juce::String grainSize      { "grainSize" };
     inline const juce::String grainDensity   { "grainDensity" };
+    inline const juce::String densityRange   { "densityRange" };
+    inline const juce::String spawnMode      { "spawnMode" };
     inline const juce::String grainPosition  { "grainPosition" };
     inline const juce::String grainPitch     { "grainPitch" };
     inline const juce::String grainPan       { "grainPan" };
@@ -22,6 +24,7 @@ namespace ParamIDs
     inline const juce::String posScatter     { "posScatter" };
     inline const juce::String pitchScatter   { "pitchScatter" };
     inline const juce::String panScatter     { "panScatter" };
+    inline const juce::String scatterShape   { "scatterShape" };
 
     // Envelope
     inline const juce::String grainAttack    { "grainAttack" };
@@ -47,4 +50,12 @@ namespace ParamIDs
     inline const juce::String outputLevel    { "outputLevel" };
     inline const juce::String dryWet         { "dryWet" };
     inline const juce::String bufferLength   { "bufferLength" };
+
+    // Engine
+    inline const juce::String interpQuality  { "interpQuality" };
+    inline const juce::String poolCapacity   { "poolCapacity" };
+    inline const juce::String stealPolicy    { "stealPolicy" };
+    inline const juce::String workerThreads  { "workerThreads" };
+    inline const juce::String renderMode     { "renderMode" };
+    inline const juce::String cpuGovernor    { "cpuGovernor" };
 }
@@ -28,6 +28,16 @@ juce::AudioProcessorValueTreeState::ParameterLayout ParameterLayout::createLayou
         kDefaultDensity,
         juce::AudioParameterFloatAttributes().withLabel ("Hz")));
 
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { ParamIDs::densityRange, 1 }, "Density Range",
+        juce::StringArray { "x1", "x10", "x40" },
+        0));
+
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { ParamIDs::spawnMode, 1 }, "Spawn Mode",
+        juce::StringArray { "Synchronous", "Quasi-Sync", "Poisson" },
+        0));
+
     params.push_back (std::make_unique<juce::AudioParameterFloat> (
         juce::ParameterID { ParamIDs::grainPosition, 1 }, "Position",
         juce::NormalisableRange<float> (0.0f, 100.0f, 0.1f),
@@ -64,6 +74,11 @@ juce::AudioProcessorValueTreeState::ParameterLayout ParameterLayout::createLayou
         30.0f,
         juce::AudioParameterFloatAttributes().withLabel ("%")));
 
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { ParamIDs::scatterShape, 1 }, "Scatter Shape",
+        juce::StringArray { "Uniform", "Gaussian", "Exponential", "Cauchy" },
+        0));
+
     // ===== Envelope =====
     params.push_back (std::make_unique<juce::AudioParameterFloat> (
         juce::ParameterID { ParamIDs::grainAttack, 1 }, "Attack",
@@ -79,7 +94,8 @@ juce::AudioProcessorValueTreeState::ParameterLayout ParameterLayout::createLayou
 
     params.push_back (std::make_unique<juce::AudioParameterChoice> (
         juce::ParameterID { ParamIDs::envelopeShape, 1 }, "Env Shape",
-        juce::StringArray { "Hanning", "Gaussian", "Triangle", "Trapezoid" },
+        juce::StringArray { "Hanning", "Gaussian", "Triangle", "Trapezoid",
+                            "Tukey", "Blackman-Harris", "Kaiser", "Exp Decay", "Custom" },
         0));
 
     // ===== Effects =====
@@ -161,5 +177,42 @@ juce::AudioProcessorValueTreeState::ParameterLayout ParameterLayout::createLayou
         kDefaultBufferSec,
         juce::AudioParameterFloatAttributes().withLabel ("s")));
 
+    // ===== Engine (quality settings, not for automation) =====
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { ParamIDs::interpQuality, 1 }, "Interpolation",
+        juce::StringArray { "Linear", "Hermite", "Sinc", "Octave Pyramid" },
+        1,
+        juce::AudioParameterChoiceAttributes().withAutomatable (false)));
+
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { ParamIDs::poolCapacity, 1 }, "Grain Pool",
+        juce::StringArray { "64", "256", "1024", "4096" },
+        1,
+        juce::AudioParameterChoiceAttributes().withAutomatable (false)));
+
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { ParamIDs::stealPolicy, 1 }, "Grain Stealing",
+        juce::StringArray { "Off", "Oldest", "Quietest", "Furthest" },
+        1,
+        juce::AudioParameterChoiceAttributes().withAutomatable (false)));
+
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { ParamIDs::workerThreads, 1 }, "Worker Threads",
+        juce::StringArray { "Off", "Auto" },
+        0,
+        juce::AudioParameterChoiceAttributes().withAutomatable (false)));
+
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { ParamIDs::renderMode, 1 }, "Render Mode",
+        juce::StringArray { "Direct", "Pipelined (+1 block latency)" },
+        0,
+        juce::AudioParameterChoiceAttributes().withAutomatable (false)));
+
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { ParamIDs::cpuGovernor, 1 }, "CPU Governor",
+        juce::StringArray { "Off", "Reduce Quality Under Load" },
+        0,
+        juce::AudioParameterChoiceAttributes().withAutomatable (false)));
+
     return { params.begin(), params.end() };
 }
@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+    RealtimeWorkerPool.h
+    A few real-time threads that help the audio thread through a batch of
+    independent tasks. The audio thread publishes a batch with atomics only,
+    works on it itself, and spins at a barrier until every task is done.
+    Idle workers spin briefly for the next batch, then park until woken.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+#if JUCE_LINUX || JUCE_BSD
+ #include <pthread.h>
+ #include <sched.h>
+#endif
+
+class RealtimeWorkerPool
+{
+public:
+    static constexpr int kMaxWorkers = 7;
+
+    /** Runs task number task of a batch. worker is 0 for the calling thread and
+        1..getNumWorkers() for the pool threads, e.g. to pick per-thread scratch. */
+    using TaskFunction = void (*) (void* context, int task, int worker);
+
+    RealtimeWorkerPool() = default;
+    ~RealtimeWorkerPool() { stop(); }
+
+    /** Start (or restart with a different count) the worker threads. Not for the
+        audio thread. Starting an empty pool may overlap a run(), which only sees
+        the workers once all of them exist; anything else must not. */
+    void start (int numWorkersToUse, double sampleRate, int blockSize)
+    {
+        numWorkersToUse = juce::jlimit (0, kMaxWorkers, numWorkersToUse);
+        if (numWorkersToUse == getNumWorkers())
+            return;
+
+        stop();
+
+        const auto options = juce::Thread::RealtimeOptions()
+                                 .withPriority (9)
+                                 .withApproximateAudioProcessingTime (blockSize, sampleRate);
+
+        for (int i = 0; i < numWorkersToUse; ++i)
+        {
+            workers[static_cast<size_t> (i)] = std::make_unique<Worker> (*this, i + 1);
+            workers[static_cast<size_t> (i)]->startRealtimeThread (options);
+        }
+
+        numWorkers.store (numWorkersToUse, std::memory_order_release);
+    }
+
+    void stop()
+    {
+        for (int i = 0; i < getNumWorkers(); ++i)
+        {
+            auto& worker = *workers[static_cast<size_t> (i)];
+            worker.signalThreadShouldExit();
+            worker.notify();
+            worker.stopThread (1000);
+        }
+
+        for (auto& worker : workers)
+            worker.reset();
+
+        numWorkers.store (0, std::memory_order_relaxed);
+    }
+
+    int getNumWorkers() const { return numWorkers.load (std::memory_order_acquire); }
+
+    /** Run tasks 0..numTasks-1 on the workers and the calling thread, and return
+        once all of them have finished. Tasks are claimed in order, but which
+        thread runs which task is up to timing. */
+    void run (TaskFunction function, void* context, int numTasks)
+    {
+        const juce::uint32 generation = getGeneration (claim.load (std::memory_order_relaxed)) + 1;
+
+        // A worker still looking at the previous batch reads the other slot
+        auto& batch = batches[generation & 1];
+        batch.function.store (function, std::memory_order_relaxed);
+        batch.context.store (context, std::memory_order_relaxed);
+        batch.numTasks.store (numTasks, std::memory_order_relaxed);
+        tasksDone.store (0, std::memory_order_relaxed);
+
+        claim.store (static_cast<juce::uint64> (generation) << 32, std::memory_order_seq_cst);
+
+        for (int i = 0, n = getNumWorkers(); i < n; ++i)
+        {
+            auto& worker = *workers[static_cast<size_t> (i)];
+            if (worker.parked.load (std::memory_order_seq_cst))
+                worker.notify();
+        }
+
+        work (generation, 0);
+
+        while (tasksDone.load (std::memory_order_acquire) < numTasks)
+            pause();
+    }
+
+    /** Back-off hint for one iteration of a spin-wait loop. */
+    static void pause()
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #else
+        std::this_thread::yield();
+       #endif
+    }
+
+private:
+    static constexpr int kSpinIterations = 2000;   // ~ tens of microseconds before parking
+
+    struct Batch
+    {
+        std::atomic<TaskFunction> function { nullptr };
+        std::atomic<void*> context { nullptr };
+        std::atomic<int> numTasks { 0 };
+    };
+
+    struct Worker : public juce::Thread
+    {
+        Worker (RealtimeWorkerPool& p, int workerIndex)
+            : juce::Thread ("Grain Worker " + juce::String (workerIndex)), pool (p), index (workerIndex)
+        {
+        }
+
+        void run() override
+        {
+            requestFifoScheduling();
+
+            juce::uint32 seen = getGeneration (pool.claim.load (std::memory_order_acquire));
+
+            while (! threadShouldExit())
+            {
+                const juce::uint32 generation = waitForBatch (seen);
+                if (generation == seen)
+                    continue;
+
+                pool.work (generation, index);
+                seen = generation;
+            }
+        }
+
+        /** Spin for a new generation, then park. Returns the generation seen last. */
+        juce::uint32 waitForBatch (juce::uint32 seen)
+        {
+            for (int i = 0; i < kSpinIterations; ++i)
+            {
+                const auto generation = getGeneration (pool.claim.load (std::memory_order_acquire));
+                if (generation != seen)
+                    return generation;
+
+                pause();
+            }
+
+            // run() checks parked after publishing, so either it sees the flag or we see the batch
+            parked.store (true, std::memory_order_seq_cst);
+
+            if (getGeneration (pool.claim.load (std::memory_order_seq_cst)) == seen && ! threadShouldExit())
+                wait (-1);
+
+            parked.store (false, std::memory_order_relaxed);
+            return getGeneration (pool.claim.load (std::memory_order_acquire));
+        }
+
+        /** Run tasks to completion under SCHED_FIFO, at the priority JUCE gave the
+            real-time thread. Needs an rtprio limit; without one the thread keeps
+            the policy it was started with. */
+        static void requestFifoScheduling()
+        {
+           #if JUCE_LINUX || JUCE_BSD
+            int policy = 0;
+            sched_param param {};
+
+            if (pthread_getschedparam (pthread_self(), &policy, &param) == 0 && policy != SCHED_OTHER)
+                pthread_setschedparam (pthread_self(), SCHED_FIFO, &param);
+           #endif
+        }
+
+        RealtimeWorkerPool& pool;
+        const int index;
+        std::atomic<bool> parked { false };
+    };
+
+    static juce::uint32 getGeneration (juce::uint64 claimValue) { return static_cast<juce::uint32> (claimValue >> 32); }
+
+    /** Claim and run tasks of one generation until none are left. The claim word
+        holds the generation in its high half, so a thread that fell behind can't
+        claim a task of a newer batch. */
+    void work (juce::uint32 generation, int worker)
+    {
+        const auto& batch = batches[generation & 1];
+
+        for (;;)
+        {
+            auto current = claim.load (std::memory_order_acquire);
+            if (getGeneration (current) != generation)
+                return;
+
+            const int task = static_cast<int> (current & 0xffffffffu);
+            const auto function = batch.function.load (std::memory_order_relaxed);
+            void* const context = batch.context.load (std::memory_order_relaxed);
+
+            if (task >= batch.numTasks.load (std::memory_order_relaxed))
+                return;
+
+            if (! claim.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel))
+                continue;
+
+            function (context, task, worker);
+            tasksDone.fetch_add (1, std::memory_order_release);
+        }
+    }
+
+    std::array<std::unique_ptr<Worker>, kMaxWorkers> workers;
+    std::atomic<int> numWorkers { 0 };
+
+    std::array<Batch, 2> batches;
+    alignas (64) std::atomic<juce::uint64> claim { 0 };       // generation << 32 | next task
+    alignas (64) std::atomic<int> tasksDone { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (RealtimeWorkerPool)
+};
@@ -0,0 +1,247 @@
+/*
+  ==============================================================================
+    TraceRecorder.h
+    Process-wide recorder of timed scopes for Chrome / Perfetto trace viewers.
+    Any thread records complete events into a preallocated lock-free ring; a
+    background thread drains it into a trace-event JSON file. Recording is
+    switched on and off at runtime. While it is off, a trace scope costs one
+    relaxed atomic load.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <memory>
+
+class TraceRecorder : private juce::Thread
+{
+public:
+    /** One finished scope. name and category must be string literals. */
+    struct Event
+    {
+        const char* name = nullptr;
+        const char* category = nullptr;
+        juce::int64 startTicks = 0;
+        juce::int64 endTicks = 0;
+        int threadId = 0;
+    };
+
+    static TraceRecorder& getInstance()
+    {
+        static TraceRecorder instance;
+        return instance;
+    }
+
+    static bool isEnabled() { return getInstance().enabled.load (std::memory_order_relaxed); }
+
+    /** Record a scope that ran from startTicks to endTicks (juce::Time high-resolution
+        ticks) on the calling thread. Never blocks; drops the event if the ring is full. */
+    static void record (const char* name, const char* category, juce::int64 startTicks, juce::int64 endTicks)
+    {
+        auto& recorder = getInstance();
+        if (recorder.enabled.load (std::memory_order_relaxed))
+            recorder.push ({ name, category, startTicks, endTicks, getThreadId() });
+    }
+
+    /** Times the enclosing scope while recording is on. */
+    class ScopedEvent
+    {
+    public:
+        ScopedEvent (const char* eventName, const char* eventCategory)
+            : name (eventName), category (eventCategory),
+              startTicks (isEnabled() ? juce::Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~ScopedEvent()
+        {
+            if (startTicks != 0)
+                record (name, category, startTicks, juce::Time::getHighResolutionTicks());
+        }
+
+    private:
+        const char* name;
+        const char* category;
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedEvent)
+    };
+
+    /** Start writing a new trace to file. Message thread. */
+    bool start (const juce::File& file)
+    {
+        stop();
+
+        file.getParentDirectory().createDirectory();
+        output = std::make_unique<juce::FileOutputStream> (file);
+        if (! output->openedOk())
+        {
+            output.reset();
+            return false;
+        }
+
+        output->setPosition (0);
+        output->truncate();
+        *output << "{\"traceEvents\":[\n";
+
+        // Discard anything a thread pushed while the last recording was stopping
+        for (Event event; pop (event);) {}
+
+        firstEvent = true;
+        originTicks = juce::Time::getHighResolutionTicks();
+        traceFile = file;
+
+        startThread (juce::Thread::Priority::low);
+        enabled.store (true);
+        return true;
+    }
+
+    /** Stop recording, write out what is left and close the file. Message thread. */
+    void stop()
+    {
+        if (output == nullptr)
+            return;
+
+        enabled.store (false);
+        stopThread (2000);
+
+        drain();
+        *output << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":"
+                << juce::String (static_cast<juce::int64> (dropped.exchange (0))) << "}}\n";
+        output->flush();
+        output.reset();
+    }
+
+    bool isRecording() const { return output != nullptr; }
+    juce::File getTraceFile() const { return traceFile; }
+
+    /** Where start() puts traces by default: a new timestamped file in the user's documents. */
+    static juce::File getDefaultTraceFile()
+    {
+        return juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+                   .getChildFile ("GranularProcessor Traces")
+                   .getChildFile ("trace-" + juce::Time::getCurrentTime().formatted ("%Y%m%d-%H%M%S") + ".json");
+    }
+
+private:
+    static constexpr int kCapacity = 1 << 16;   // events, about 3 MB
+    static constexpr int kDrainIntervalMs = 50;
+
+    struct Cell
+    {
+        std::atomic<juce::uint64> sequence { 0 };
+        Event event;
+    };
+
+    TraceRecorder()
+        : juce::Thread ("Trace Writer"),
+          cells (std::make_unique<Cell[]> (static_cast<size_t> (kCapacity)))
+    {
+        for (int i = 0; i < kCapacity; ++i)
+            cells[static_cast<size_t> (i)].sequence.store (static_cast<juce::uint64> (i), std::memory_order_relaxed);
+    }
+
+    ~TraceRecorder() override { stop(); }
+
+    /** Small, stable per-thread number for the trace's tid field. */
+    static int getThreadId()
+    {
+        static std::atomic<int> nextId { 1 };
+        thread_local const int id = nextId.fetch_add (1, std::memory_order_relaxed);
+        return id;
+    }
+
+    /** Bounded multi-producer queue (Vyukov): each cell's sequence says whether
+        it is free for position pos (== pos) or holds the event for pos (== pos + 1). */
+    void push (const Event& event)
+    {
+        auto pos = head.load (std::memory_order_relaxed);
+
+        for (;;)
+        {
+            auto& cell = cells[static_cast<size_t> (pos & kMask)];
+            const auto sequence = cell.sequence.load (std::memory_order_acquire);
+            const auto diff = static_cast<juce::int64> (sequence - pos);
+
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.event = event;
+                    cell.sequence.store (pos + 1, std::memory_order_release);
+                    return;
+                }
+            }
+            else if (diff < 0)
+            {
+                dropped.fetch_add (1, std::memory_order_relaxed);
+                return;
+            }
+            else
+            {
+                pos = head.load (std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop (Event& event)
+    {
+        auto& cell = cells[static_cast<size_t> (tail & kMask)];
+        if (cell.sequence.load (std::memory_order_acquire) != tail + 1)
+            return false;
+
+        event = cell.event;
+        cell.sequence.store (tail + kCapacity, std::memory_order_release);
+        ++tail;
+        return true;
+    }
+
+    void drain()
+    {
+        const double microsPerTick = 1.0e6 / static_cast<double> (juce::Time::getHighResolutionTicksPerSecond());
+        Event event;
+
+        while (pop (event))
+        {
+            if (! firstEvent)
+                *output << ",\n";
+
+            firstEvent = false;
+            *output << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                    << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << juce::String (event.threadId)
+                    << ",\"ts\":" << juce::String (static_cast<double> (event.startTicks - originTicks) * microsPerTick, 3)
+                    << ",\"dur\":" << juce::String (static_cast<double> (event.endTicks - event.startTicks) * microsPerTick, 3)
+                    << "}";
+        }
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            drain();
+            wait (kDrainIntervalMs);
+        }
+    }
+
+    static constexpr juce::uint64 kMask = kCapacity - 1;
+
+    std::unique_ptr<Cell[]> cells;
+    alignas (64) std::atomic<juce::uint64> head { 0 };
+    alignas (64) juce::uint64 tail = 0;          // writer thread only
+    std::atomic<juce::uint64> dropped { 0 };
+    std::atomic<bool> enabled { false };
+
+    std::unique_ptr<juce::FileOutputStream> output;
+    juce::File traceFile;
+    juce::int64 originTicks = 0;
+    bool firstEvent = true;
+
+    JUCE_DECLARE_NON_COPYABLE (TraceRecorder)
+};
+
+/** Trace the enclosing scope under a literal name and category. */
+#define GRANULAR_TRACE_SCOPE(name, category) \
+    TraceRecorder::ScopedEvent JUCE_JOIN_MACRO (traceScope_, __LINE__) (name, category)
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+    TripleBuffer.h
+    Wait-free single-producer / single-consumer hand-off of a value type.
+    The producer fills the write buffer and publishes it; the consumer pulls
+    the most recent publication and reads it for as long as it likes.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    /** Producer: the buffer to fill before the next publish(). */
+    T& getWriteBuffer() { return buffers[static_cast<size_t> (writeIndex)]; }
+
+    /** Producer: hand the write buffer to the consumer. Never blocks. */
+    void publish()
+    {
+        writeIndex = middle.exchange (writeIndex | kDirtyFlag, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    /** Consumer: take the latest published buffer, if there is a new one.
+        Returns false (and keeps the current read buffer) if nothing was published. */
+    bool pull()
+    {
+        if ((middle.load (std::memory_order_relaxed) & kDirtyFlag) == 0)
+            return false;
+
+        readIndex = middle.exchange (readIndex, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    /** Consumer: the buffer obtained by the last successful pull(). */
+    const T& getReadBuffer() const { return buffers[static_cast<size_t> (readIndex)]; }
+
+private:
+    static constexpr int kIndexMask = 3;
+    static constexpr int kDirtyFlag = 4;
+
+    std::array<T, 3> buffers {};
+    int writeIndex = 0;
+    int readIndex  = 1;
+    std::atomic<int> middle { 2 };
+
+    TripleBuffer (const TripleBuffer&) = delete;
+    TripleBuffer& operator= (const TripleBuffer&) = delete;
+};
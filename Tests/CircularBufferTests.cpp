@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+    CircularBufferTests.cpp
+    Reads at the edges of the ring, where the interpolation windows run into
+    the guard frames, against a reference that wraps every tap explicitly,
+    and the octave levels against the block just written.
+  ==============================================================================
+*/
+
+#include "DSP/CircularBuffer.h"
+#include <juce_core/juce_core.h>
+#include <vector>
+
+class CircularBufferTests : public juce::UnitTest
+{
+public:
+    CircularBufferTests() : juce::UnitTest ("CircularBuffer", "GranularProcessor") {}
+
+    void runTest() override
+    {
+        CircularBuffer buffer;
+        buffer.prepare (kSampleRate, 2, 1.0f);
+        const int capacity = buffer.getCapacity();
+
+        // Fill the whole ring once, so the write head is back at 0
+        juce::Random random (1);
+        std::vector<float> left (static_cast<size_t> (capacity)), right (static_cast<size_t> (capacity));
+        for (int i = 0; i < capacity; ++i)
+        {
+            left[static_cast<size_t> (i)]  = random.nextFloat() * 2.0f - 1.0f;
+            right[static_cast<size_t> (i)] = random.nextFloat() * 2.0f - 1.0f;
+        }
+
+        const float* channels[] = { left.data(), right.data() };
+        buffer.writeBlock (channels, 2, capacity);
+
+        SincTable sincTable;
+
+        // The first and the longest kernel banks
+        for (float rate : { 1.0f, 3.0f, 8.0f })
+        {
+            beginTest ("Sinc reads at the end of the ring, rate " + juce::String (rate, 1));
+
+            const auto& bank = sincTable.getBank (rate);
+
+            for (int whole = capacity - 8; whole <= capacity; ++whole)
+                expectSincReadsMatch (buffer, bank, left, right, whole);
+
+            beginTest ("Sinc reads at the start of the ring, rate " + juce::String (rate, 1));
+
+            for (int whole = -8; whole <= 8; ++whole)
+                expectSincReadsMatch (buffer, bank, left, right, whole);
+        }
+
+        testOctaveLevels();
+    }
+
+private:
+    static constexpr double kSampleRate = 1024.0;   // a 1 s ring of 1024 frames
+    static constexpr int kBlockSize = 256;
+
+    /** A block of DC decimates to the same DC (the half-band taps sum to 1) on
+        every octave sample whose taps lie inside it. */
+    void testOctaveLevels()
+    {
+        CircularBuffer buffer;
+        buffer.prepare (kSampleRate, 2, 1.0f);
+
+        std::vector<float> ones (static_cast<size_t> (kBlockSize), 1.0f);
+        const float* channels[] = { ones.data(), ones.data() };
+
+        beginTest ("Octave levels include the block just written");
+        buffer.writeBlock (channels, 2, kBlockSize);
+        expectOctavesEqual (buffer, 1.0f);
+
+        beginTest ("Octave levels include feedback mixed into that block");
+        buffer.addBlock (0, channels, 2, kBlockSize, 1.0f);
+        expectOctavesEqual (buffer, 2.0f);
+    }
+
+    void expectOctavesEqual (const CircularBuffer& buffer, float expected)
+    {
+        for (int octave = 1; octave <= CircularBuffer::kNumOctaves; ++octave)
+        {
+            const auto ring = buffer.getRing (octave);
+
+            // Level k sample j is centred on level-0 frame j << k, and the filters reach
+            // 5 frames per level to either side: 35 frames at level 3
+            const int reach = 5 * ((1 << octave) - 1);
+
+            for (int j = (reach >> octave) + 1; ((j << octave) + reach) < kBlockSize; ++j)
+                for (int ch = 0; ch < CircularBuffer::kFrameSize; ++ch)
+                    expectWithinAbsoluteError (ring.frames[j * CircularBuffer::kFrameSize + ch], expected, 1.0e-5f,
+                                               "octave " + juce::String (octave) + " sample " + juce::String (j));
+        }
+    }
+
+    void expectSincReadsMatch (const CircularBuffer& buffer, const SincTable::Bank& bank,
+                               const std::vector<float>& left, const std::vector<float>& right, int whole)
+    {
+        const int capacity = buffer.getCapacity();
+
+        for (float frac : { 0.0f, 0.25f, 0.5f, 0.999f })
+        {
+            const float* w = SincTable::getKernel (bank, frac);
+            float expectedL = 0.0f, expectedR = 0.0f;
+
+            for (int k = 0; k < bank.taps; ++k)
+            {
+                const int index = (whole - (bank.taps / 2 - 1) + k) & (capacity - 1);
+                expectedL += w[k] * left[static_cast<size_t> (index)];
+                expectedR += w[k] * right[static_cast<size_t> (index)];
+            }
+
+            float l = 0.0f, r = 0.0f;
+            buffer.readStereoSinc (whole, frac, bank, l, r);
+
+            const auto where = " at " + juce::String (whole) + " + " + juce::String (frac, 3);
+            expectWithinAbsoluteError (l, expectedL, 1.0e-5f, "stereo left" + where);
+            expectWithinAbsoluteError (r, expectedR, 1.0e-5f, "stereo right" + where);
+            expectWithinAbsoluteError (buffer.readSampleSinc (0, whole, frac, bank), expectedL, 1.0e-5f, "mono left" + where);
+            expectWithinAbsoluteError (buffer.readSampleSinc (1, whole, frac, bank), expectedR, 1.0e-5f, "mono right" + where);
+        }
+    }
+};
+
+static CircularBufferTests circularBufferTests;
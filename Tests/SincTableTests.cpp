@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+    SincTableTests.cpp
+    Measures the band limiting of sinc reads from CircularBuffer. The ring
+    holds a complex tone, cosine on the left and sine on the right, so the
+    magnitude of every stereo read is the kernel's exact gain at that tone
+    and fractional position.
+  ==============================================================================
+*/
+
+#include "DSP/CircularBuffer.h"
+#include <juce_core/juce_core.h>
+#include <cmath>
+#include <vector>
+
+class SincTableTests : public juce::UnitTest
+{
+public:
+    SincTableTests() : juce::UnitTest ("SincTable", "GranularProcessor") {}
+
+    void runTest() override
+    {
+        buffer.prepare (kSampleRate, 2, 1.0f);
+        left.resize (static_cast<size_t> (buffer.getCapacity()));
+        right.resize (static_cast<size_t> (buffer.getCapacity()));
+
+        for (float rate : { 1.4f, 1.5f, 2.0f, 2.5f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f })
+        {
+            beginTest ("Rejection of folding components, rate " + juce::String (rate, 2));
+
+            // Tones the grain would fold back below 0.35 of the sample rate
+            const double stopEdge = 0.65 / rate;
+            double worstDb = -1000.0;
+
+            for (int i = 0; i <= kNumStopTones; ++i)
+            {
+                const double frequency = stopEdge + (0.5 - stopEdge) * i / kNumStopTones;
+                worstDb = juce::jmax (worstDb, juce::Decibels::gainToDecibels (getPeakGain (frequency, rate), -200.0));
+            }
+
+            expectLessOrEqual (worstDb, -kRejectionDb, "worst stopband gain in dB");
+
+            beginTest ("Passband, rate " + juce::String (rate, 2));
+
+            // 0.4 of the grain's Nyquist limit; banks are half an octave apart
+            const double passbandGain = getPeakGain (0.2 / rate, rate, true);
+            expectWithinAbsoluteError (juce::Decibels::gainToDecibels (passbandGain), 0.0, kPassbandRippleDb,
+                                       "passband gain in dB");
+        }
+    }
+
+private:
+    static constexpr double kSampleRate = 32768.0;   // a 1 s ring of 32768 frames
+    static constexpr int kNumStopTones = 24;
+    static constexpr int kNumReads = 2000;
+    static constexpr double kRejectionDb = 70.0;     // the figure SincTable claims
+    static constexpr double kPassbandRippleDb = 0.1;
+
+    /** Fill the ring with a unit complex tone at frequency (cycles per sample), read
+        it at the given rate and return the largest (or smallest) read magnitude. */
+    double getPeakGain (double frequency, float rate, bool smallest = false)
+    {
+        const int capacity = buffer.getCapacity();
+
+        for (int i = 0; i < capacity; ++i)
+        {
+            const double phase = juce::MathConstants<double>::twoPi * frequency * i;
+            left[static_cast<size_t> (i)]  = static_cast<float> (std::cos (phase));
+            right[static_cast<size_t> (i)] = static_cast<float> (std::sin (phase));
+        }
+
+        const float* channels[] = { left.data(), right.data() };
+        buffer.writeBlock (channels, 2, capacity);
+
+        const auto& bank = sincTable.getBank (rate);
+        double peak = smallest ? 1000.0 : 0.0;
+
+        // Start well inside the ring, at a fraction that does not repeat with the rate
+        for (int n = 0; n < kNumReads; ++n)
+        {
+            const double position = 1000.37 + n * static_cast<double> (rate);
+            const auto whole = static_cast<int> (position);
+
+            float l = 0.0f, r = 0.0f;
+            buffer.readStereoSinc (whole, static_cast<float> (position - whole), bank, l, r);
+
+            const double gain = std::sqrt (static_cast<double> (l) * l + static_cast<double> (r) * r);
+            peak = smallest ? juce::jmin (peak, gain) : juce::jmax (peak, gain);
+        }
+
+        return peak;
+    }
+
+    CircularBuffer buffer;
+    SincTable sincTable;
+    std::vector<float> left, right;
+};
+
+static SincTableTests sincTableTests;
@@ -0,0 +1,21 @@
+/*
+  ==============================================================================
+    TestMain.cpp
+    Runs every juce::UnitTest in the "GranularProcessor" category and returns
+    the number of failed checks, so ctest reports any failure.
+  ==============================================================================
+*/
+
+#include <juce_core/juce_core.h>
+
+int main()
+{
+    juce::UnitTestRunner runner;
+    runner.runTestsInCategory ("GranularProcessor");
+
+    int failures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult (i)->failures;
+
+    return failures;
+}
@@ -612,6 +612,21 @@ __MODULES__
         juce::juce_recommended_config_flags
         juce::juce_recommended_warning_flags
 )
+
+# -- Benchmark -----------------------------------------------------------------
+option(GRANULAR_BUILD_BENCHMARK "Build the headless GranularBenchmark executable" OFF)
+
+if(GRANULAR_BUILD_BENCHMARK AND EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/Benchmark/CMakeLists.txt")
+    add_subdirectory(Benchmark)
+endif()
+
+# -- Tests ---------------------------------------------------------------------
+option(GRANULAR_BUILD_TESTS "Build the GranularTests unit tests" OFF)
+
+if(GRANULAR_BUILD_TESTS AND EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/Tests/CMakeLists.txt")
+    enable_testing()
+    add_subdirectory(Tests)
+endif()
 '@
 
 $cmakeContent = $cmakeTemplate `